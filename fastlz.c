@@ -69,9 +69,54 @@ static void fastlz_memcpy(uint8_t* dest, const uint8_t* src, uint32_t count) {
 
 #include <string.h>
 
+/*
+  Overlapping copy, i.e. a match at a distance shorter than its length,
+  repeats the pattern between src and dest. A run of a single byte is a
+  memset. Otherwise the pattern is doubled, as a whole for a long match
+  (so that no copy depends on the one just before), or until it is wide
+  enough to be copied a word at a time.
+*/
+static void flz_repcopy(uint8_t* dest, const uint8_t* src, uint32_t count) {
+  uint32_t distance = dest - src;
+  if (distance == 1) {
+    memset(dest, *src, count);
+    return;
+  }
+  if (count >= 64) {
+    while (count > distance) {
+      memcpy(dest, src, distance);
+      dest += distance;
+      count -= distance;
+      distance += distance;
+    }
+    memcpy(dest, src, count);
+    return;
+  }
+#if defined(FLZ_ARCH64)
+  while (distance < 8 && count > distance) {
+    memcpy(dest, src, distance);
+    dest += distance;
+    count -= distance;
+    distance += distance;
+  }
+  while (count >= 8) {
+    memcpy(dest, src, 8);
+    dest += 8;
+    src += 8;
+    count -= 8;
+  }
+#endif
+  while (count > 0) {
+    *dest++ = *src++;
+    --count;
+  }
+}
+
 static void fastlz_memmove(uint8_t* dest, const uint8_t* src, uint32_t count) {
   if ((count > 4) && (dest >= src + count)) {
     memmove(dest, src, count);
+  } else if ((count > 4) && (dest > src)) {
+    flz_repcopy(dest, src, count);
   } else {
     switch (count) {
       default:
@@ -99,12 +144,15 @@ static void fastlz_memcpy(uint8_t* dest, const uint8_t* src, uint32_t count) { m
 
 static uint32_t flz_readu32(const void* ptr) { return *(const uint32_t*)ptr; }
 
+static uint64_t flz_readu64(const void* ptr) { return *(const uint64_t*)ptr; }
+
+/* long matches, notably runs of the same byte, are compared a word at a time */
 static uint32_t flz_cmp(const uint8_t* p, const uint8_t* q, const uint8_t* r) {
   const uint8_t* start = p;
 
-  if (flz_readu32(p) == flz_readu32(q)) {
-    p += 4;
-    q += 4;
+  while (q + 8 <= r && flz_readu64(p) == flz_readu64(q)) {
+    p += 8;
+    q += 8;
   }
   while (q < r)
     if (*p++ != *q++) break;
@@ -215,22 +263,63 @@ static uint8_t* flz1_match(uint32_t len, uint32_t distance, uint8_t* op) {
   return op;
 }
 
+/*
+ * Instrumentation for fastlz_compress_ex, compiled out unless FASTLZ_STATS.
+ */
+#if defined(FASTLZ_STATS)
+
+typedef struct fastlz_stats flz_stats;
+
+#define FLZ_STATS(stmt) \
+  if (FASTLZ_UNLIKELY(stats != 0)) {     \
+    stmt;                                \
+  }
+
+static void flz_stats_match(flz_stats* stats, uint32_t len, int far) {
+  uint32_t bucket = 0;
+  while ((len >> bucket) > 1) ++bucket;
+  stats->matches++;
+  stats->match_bytes += len;
+  stats->match_lengths[bucket]++;
+  if (far)
+    stats->far_matches++;
+  else
+    stats->near_matches++;
+}
+
+#else
+
+typedef void flz_stats;
+
+#define FLZ_STATS(stmt) (void)stats
+
+#endif /* FASTLZ_STATS */
+
 #define FASTLZ_BOUND_CHECK(cond) \
   if (FASTLZ_UNLIKELY(!(cond))) return 0;
 
-static int fastlz1_compress(const void* input, int length, void* output) {
+/*
+  Positions in the hash table are stored relative to ip_start, which is
+  the start of the block moved back by base. When compressing several blocks
+  with the same hash table, giving each block a base beyond the last
+  position of the previous block plus the maximum distance guarantees that
+  the stale entries are always rejected by the distance check, hence the
+  hash table needs to be initialized only once.
+
+  A match which ends a literal run costs an extra instruction to decode.
+  Such a match is dropped if it is shorter than min_len (0 to take every
+  match), trading some compression ratio for decompression speed.
+*/
+static int flz1_compress(uint32_t* htab, uint32_t base, uint32_t min_len, const void* input, int length,
+                         void* output, flz_stats* stats) {
   const uint8_t* ip = (const uint8_t*)input;
-  const uint8_t* ip_start = ip;
+  const uint8_t* ip_start = ip - base;
   const uint8_t* ip_bound = ip + length - 4; /* because readU32 */
   const uint8_t* ip_limit = ip + length - 12 - 1;
   uint8_t* op = (uint8_t*)output;
 
-  uint32_t htab[HASH_SIZE];
   uint32_t seq, hash;
 
-  /* initializes hash table */
-  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
-
   /* we start with literal copy */
   const uint8_t* anchor = ip;
   ip += 2;
@@ -248,6 +337,8 @@ static int fastlz1_compress(const void* input, int length, void* output) {
       htab[hash] = ip - ip_start;
       distance = ip - ref;
       cmp = FASTLZ_LIKELY(distance < MAX_L1_DISTANCE) ? flz_readu32(ref) & 0xffffff : 0x1000000;
+      FLZ_STATS(if (cmp > 0xffffff) stats->hash_misses++; else if (seq != cmp) stats->hash_collisions++;
+                else stats->hash_hits++);
       if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
       ++ip;
     } while (seq != cmp);
@@ -255,12 +346,20 @@ static int fastlz1_compress(const void* input, int length, void* output) {
     if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
     --ip;
 
+    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
+    if (FASTLZ_UNLIKELY(len + 2 < min_len) && ip > anchor) {
+      FLZ_STATS(stats->hash_hits--; stats->hash_collisions++);
+      ++ip;
+      continue;
+    }
+
     if (FASTLZ_LIKELY(ip > anchor)) {
+      FLZ_STATS(stats->literal_runs++; stats->literal_bytes += ip - anchor);
       op = flz_literals(ip - anchor, anchor, op);
     }
 
-    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
     op = flz1_match(len, distance, op);
+    FLZ_STATS(flz_stats_match(stats, len + 2, 0); stats->bytes_skipped += len - 1);
 
     /* update the hash at match boundary */
     ip += len;
@@ -275,11 +374,22 @@ static int fastlz1_compress(const void* input, int length, void* output) {
   }
 
   uint32_t copy = (uint8_t*)input + length - anchor;
+  FLZ_STATS(if (copy > 0) stats->literal_runs++; stats->literal_bytes += copy);
   op = flz_literals(copy, anchor, op);
 
   return op - (uint8_t*)output;
 }
 
+static int fastlz1_compress(const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  return flz1_compress(htab, 0, 0, input, length, output, 0);
+}
+
 static int fastlz1_decompress(const void* input, int length, void* output, int maxout) {
   const uint8_t* ip = (const uint8_t*)input;
   const uint8_t* ip_limit = ip + length;
@@ -301,13 +411,19 @@ static int fastlz1_decompress(const void* input, int length, void* output, int m
       len += 3;
       FASTLZ_BOUND_CHECK(op + len <= op_limit);
       FASTLZ_BOUND_CHECK(ref >= (uint8_t*)output);
-      fastlz_memmove(op, ref, len);
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
       op += len;
     } else {
       ctrl++;
       FASTLZ_BOUND_CHECK(op + ctrl <= op_limit);
       FASTLZ_BOUND_CHECK(ip + ctrl <= ip_limit);
-      fastlz_memcpy(op, ip, ctrl);
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
       ip += ctrl;
       op += ctrl;
     }
@@ -319,6 +435,43 @@ static int fastlz1_decompress(const void* input, int length, void* output, int m
   return op - (uint8_t*)output;
 }
 
+static int fastlz1_decompress_trusted(const void* input, int length, void* output, int outlen) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + outlen;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 31) << 8;
+      const uint8_t* ref = op - ofs - 1;
+      if (len == 7 - 1) len += *ip++;
+      ref -= *ip++;
+      len += 3;
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      ctrl++;
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
+      ip += ctrl;
+      op += ctrl;
+    }
+
+    if (FASTLZ_UNLIKELY(op >= op_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
+}
+
 static uint8_t* flz2_match(uint32_t len, uint32_t distance, uint8_t* op) {
   --distance;
   if (distance < MAX_L2_DISTANCE) {
@@ -352,19 +505,16 @@ static uint8_t* flz2_match(uint32_t len, uint32_t distance, uint8_t* op) {
   return op;
 }
 
-static int fastlz2_compress(const void* input, int length, void* output) {
+static int flz2_compress(uint32_t* htab, uint32_t base, uint32_t min_len, const void* input, int length,
+                         void* output, flz_stats* stats) {
   const uint8_t* ip = (const uint8_t*)input;
-  const uint8_t* ip_start = ip;
+  const uint8_t* ip_start = ip - base;
   const uint8_t* ip_bound = ip + length - 4; /* because readU32 */
   const uint8_t* ip_limit = ip + length - 12 - 1;
   uint8_t* op = (uint8_t*)output;
 
-  uint32_t htab[HASH_SIZE];
   uint32_t seq, hash;
 
-  /* initializes hash table */
-  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
-
   /* we start with literal copy */
   const uint8_t* anchor = ip;
   ip += 2;
@@ -382,6 +532,8 @@ static int fastlz2_compress(const void* input, int length, void* output) {
       htab[hash] = ip - ip_start;
       distance = ip - ref;
       cmp = FASTLZ_LIKELY(distance < MAX_FARDISTANCE) ? flz_readu32(ref) & 0xffffff : 0x1000000;
+      FLZ_STATS(if (cmp > 0xffffff) stats->hash_misses++; else if (seq != cmp) stats->hash_collisions++;
+                else stats->hash_hits++);
       if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
       ++ip;
     } while (seq != cmp);
@@ -393,17 +545,26 @@ static int fastlz2_compress(const void* input, int length, void* output) {
     /* far, needs at least 5-byte match */
     if (distance >= MAX_L2_DISTANCE) {
       if (ref[3] != ip[3] || ref[4] != ip[4]) {
+        FLZ_STATS(stats->hash_hits--; stats->hash_collisions++);
         ++ip;
         continue;
       }
     }
 
+    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
+    if (FASTLZ_UNLIKELY(len + 2 < min_len) && ip > anchor) {
+      FLZ_STATS(stats->hash_hits--; stats->hash_collisions++);
+      ++ip;
+      continue;
+    }
+
     if (FASTLZ_LIKELY(ip > anchor)) {
+      FLZ_STATS(stats->literal_runs++; stats->literal_bytes += ip - anchor);
       op = flz_literals(ip - anchor, anchor, op);
     }
 
-    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
     op = flz2_match(len, distance, op);
+    FLZ_STATS(flz_stats_match(stats, len + 2, distance >= MAX_L2_DISTANCE); stats->bytes_skipped += len - 1);
 
     /* update the hash at match boundary */
     ip += len;
@@ -418,6 +579,7 @@ static int fastlz2_compress(const void* input, int length, void* output) {
   }
 
   uint32_t copy = (uint8_t*)input + length - anchor;
+  FLZ_STATS(if (copy > 0) stats->literal_runs++; stats->literal_bytes += copy);
   op = flz_literals(copy, anchor, op);
 
   /* marker for fastlz2 */
@@ -426,6 +588,16 @@ static int fastlz2_compress(const void* input, int length, void* output) {
   return op - (uint8_t*)output;
 }
 
+static int fastlz2_compress(const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  return flz2_compress(htab, 0, 0, input, length, output, 0);
+}
+
 static int fastlz2_decompress(const void* input, int length, void* output, int maxout) {
   const uint8_t* ip = (const uint8_t*)input;
   const uint8_t* ip_limit = ip + length;
@@ -446,6 +618,7 @@ static int fastlz2_decompress(const void* input, int length, void* output, int m
           code = *ip++;
           len += code;
         } while (code == 255);
+      FASTLZ_BOUND_CHECK(ip < ip_limit);
       code = *ip++;
       ref -= code;
       len += 3;
@@ -461,13 +634,19 @@ static int fastlz2_decompress(const void* input, int length, void* output, int m
 
       FASTLZ_BOUND_CHECK(op + len <= op_limit);
       FASTLZ_BOUND_CHECK(ref >= (uint8_t*)output);
-      fastlz_memmove(op, ref, len);
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
       op += len;
     } else {
       ctrl++;
       FASTLZ_BOUND_CHECK(op + ctrl <= op_limit);
       FASTLZ_BOUND_CHECK(ip + ctrl <= ip_limit);
-      fastlz_memcpy(op, ip, ctrl);
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
       ip += ctrl;
       op += ctrl;
     }
@@ -479,30 +658,2266 @@ static int fastlz2_decompress(const void* input, int length, void* output, int m
   return op - (uint8_t*)output;
 }
 
-int fastlz_compress(const void* input, int length, void* output) {
-  /* for short block, choose fastlz1 */
-  if (length < 65536) return fastlz1_compress(input, length, output);
+static int fastlz2_decompress_trusted(const void* input, int length, void* output, int outlen) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + outlen;
+  uint32_t ctrl = (*ip++) & 31;
 
-  /* else... */
-  return fastlz2_compress(input, length, output);
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 31) << 8;
+      const uint8_t* ref = op - ofs - 1;
+
+      uint8_t code;
+      if (len == 7 - 1) do {
+          code = *ip++;
+          len += code;
+        } while (code == 255);
+      code = *ip++;
+      ref -= code;
+      len += 3;
+
+      /* match from 16-bit distance */
+      if (FASTLZ_UNLIKELY(code == 255))
+        if (FASTLZ_LIKELY(ofs == (31 << 8))) {
+          ofs = (*ip++) << 8;
+          ofs += *ip++;
+          ref = op - ofs - MAX_L2_DISTANCE - 1;
+        }
+
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      ctrl++;
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
+      ip += ctrl;
+      op += ctrl;
+    }
+
+    if (FASTLZ_UNLIKELY(op >= op_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
 }
 
-int fastlz_decompress(const void* input, int length, void* output, int maxout) {
-  /* magic identifier for compression level */
-  int level = ((*(const uint8_t*)input) >> 5) + 1;
+#define MAX_L3_NEAR 4096
+#define MAX_L3_DISTANCE 65536
 
-  if (level == 1) return fastlz1_decompress(input, length, output, maxout);
-  if (level == 2) return fastlz2_decompress(input, length, output, maxout);
+/*
+  Level 3 uses the level 1 opcodes, except that bit 4 of a match opcode
+  selects between a near match (12-bit distance in the low 4 bits and the
+  next byte) and a far match (16-bit distance in the next two bytes).
+*/
+static uint8_t* flz3_match(uint32_t len, uint32_t distance, uint8_t* op) {
+  uint32_t code;
+  --distance;
+  code = (distance < MAX_L3_NEAR) ? (distance >> 8) : 16;
+  while (FASTLZ_UNLIKELY(len > MAX_LEN - 2)) {
+    *op++ = (7 << 5) + code;
+    *op++ = MAX_LEN - 2 - 7 - 2;
+    *op++ = (distance & 255);
+    if (code == 16) *op++ = (distance >> 8);
+    len -= MAX_LEN - 2;
+  }
+  if (len < 7) {
+    *op++ = (len << 5) + code;
+  } else {
+    *op++ = (7 << 5) + code;
+    *op++ = len - 7;
+  }
+  *op++ = (distance & 255);
+  if (code == 16) *op++ = (distance >> 8);
+  return op;
+}
 
-  /* unknown level, trigger error */
-  return 0;
+static int flz3_compress(uint32_t* htab, uint32_t base, const void* input, int length, void* output,
+                         flz_stats* stats) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_start = ip - base;
+  const uint8_t* ip_bound = ip + length - 4; /* because readU32 */
+  const uint8_t* ip_limit = ip + length - 12 - 1;
+  uint8_t* op = (uint8_t*)output;
+
+  uint32_t seq, hash;
+
+  /* we start with literal copy */
+  const uint8_t* anchor = ip;
+  ip += 2;
+
+  /* main loop */
+  while (FASTLZ_LIKELY(ip < ip_limit)) {
+    const uint8_t* ref;
+    uint32_t distance, cmp;
+
+    /* find potential match */
+    do {
+      seq = flz_readu32(ip) & 0xffffff;
+      hash = flz_hash(seq);
+      ref = ip_start + htab[hash];
+      htab[hash] = ip - ip_start;
+      distance = ip - ref;
+      cmp = FASTLZ_LIKELY(distance <= MAX_L3_DISTANCE) ? flz_readu32(ref) & 0xffffff : 0x1000000;
+      FLZ_STATS(if (cmp > 0xffffff) stats->hash_misses++; else if (seq != cmp) stats->hash_collisions++;
+                else stats->hash_hits++);
+      if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+      ++ip;
+    } while (seq != cmp);
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    --ip;
+
+    /* far, needs at least 4-byte match */
+    if (distance > MAX_L3_NEAR && ref[3] != ip[3]) {
+      FLZ_STATS(stats->hash_hits--; stats->hash_collisions++);
+      ++ip;
+      continue;
+    }
+
+    if (FASTLZ_LIKELY(ip > anchor)) {
+      FLZ_STATS(stats->literal_runs++; stats->literal_bytes += ip - anchor);
+      op = flz_literals(ip - anchor, anchor, op);
+    }
+
+    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
+    op = flz3_match(len, distance, op);
+    FLZ_STATS(flz_stats_match(stats, len + 2, distance > MAX_L3_NEAR); stats->bytes_skipped += len - 1);
+
+    /* update the hash at match boundary */
+    ip += len;
+    seq = flz_readu32(ip);
+    hash = flz_hash(seq & 0xffffff);
+    htab[hash] = ip++ - ip_start;
+    seq >>= 8;
+    hash = flz_hash(seq);
+    htab[hash] = ip++ - ip_start;
+
+    anchor = ip;
+  }
+
+  uint32_t copy = (uint8_t*)input + length - anchor;
+  FLZ_STATS(if (copy > 0) stats->literal_runs++; stats->literal_bytes += copy);
+  op = flz_literals(copy, anchor, op);
+
+  /* marker for fastlz3 */
+  *(uint8_t*)output |= (2 << 5);
+
+  return op - (uint8_t*)output;
 }
 
-int fastlz_compress_level(int level, const void* input, int length, void* output) {
-  if (level == 1) return fastlz1_compress(input, length, output);
-  if (level == 2) return fastlz2_compress(input, length, output);
+static int fastlz3_compress(const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash;
 
-  return 0;
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  return flz3_compress(htab, 0, input, length, output, 0);
+}
+
+static int fastlz3_decompress(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + maxout;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 15) << 8;
+      if (len == 7 - 1) {
+        FASTLZ_BOUND_CHECK(ip < ip_limit);
+        len += *ip++;
+      }
+      uint32_t far = (ctrl >> 4) & 1;
+      FASTLZ_BOUND_CHECK(ip + far < ip_limit);
+      ofs += ip[0] + ((ip[far] << 8) & (0 - far));
+      ip += 1 + far;
+      const uint8_t* ref = op - ofs - 1;
+      len += 3;
+      FASTLZ_BOUND_CHECK(op + len <= op_limit);
+      FASTLZ_BOUND_CHECK(ref >= (uint8_t*)output);
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      ctrl++;
+      FASTLZ_BOUND_CHECK(op + ctrl <= op_limit);
+      FASTLZ_BOUND_CHECK(ip + ctrl <= ip_limit);
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
+      ip += ctrl;
+      op += ctrl;
+    }
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
 }
 
+static int fastlz3_decompress_trusted(const void* input, int length, void* output, int outlen) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + outlen;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 15) << 8;
+      if (len == 7 - 1) len += *ip++;
+      uint32_t far = (ctrl >> 4) & 1;
+      ofs += ip[0] + ((ip[far] << 8) & (0 - far));
+      ip += 1 + far;
+      const uint8_t* ref = op - ofs - 1;
+      len += 3;
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      ctrl++;
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
+      ip += ctrl;
+      op += ctrl;
+    }
+
+    if (FASTLZ_UNLIKELY(op >= op_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
+}
+
+#define MAX_L4_DISTANCE (1 << 24)
+#define LR_HASH_LOG 14
+#define LR_HASH_SIZE (1 << LR_HASH_LOG)
+#define LR_ANCHOR_MASK 255
+
+/*
+  Level 4 extends level 3 with 24-bit distances: in a far match, bit 3 of
+  the opcode marks a third distance byte. Long matches use the level 2
+  length encoding, so that a repeat of megabytes takes only a few bytes.
+*/
+static uint8_t* flz4_match(uint32_t len, uint32_t distance, uint8_t* op) {
+  uint32_t code;
+  --distance;
+  code = (distance < MAX_L3_NEAR) ? (distance >> 8) : (distance < MAX_L3_DISTANCE) ? 16 : 16 + 8;
+  if (len < 7) {
+    *op++ = (len << 5) + code;
+  } else {
+    *op++ = (7 << 5) + code;
+    for (len -= 7; len >= 255; len -= 255) *op++ = 255;
+    *op++ = len;
+  }
+  *op++ = (distance & 255);
+  if (code >= 16) {
+    *op++ = (distance >> 8) & 255;
+    if (code & 8) *op++ = (distance >> 16);
+  }
+  return op;
+}
+
+/* hash of 8 bytes, for the long-range table */
+static uint32_t flz_lr_hash(uint32_t v, uint32_t w) {
+  uint32_t h = (v ^ (w * 2654435769U)) * 2654435769U;
+  return h >> (32 - LR_HASH_LOG);
+}
+
+/*
+  Besides the regular hash table for the 64 KB window, level 4 keeps a
+  sparse table of anchors for the whole 16 MB window. A position is an
+  anchor only if its regular hash has the low 8 bits cleared. Since this
+  depends on the content only, a repeat of an earlier region has its
+  anchors at the same spots, and one lookup per anchor is enough to find
+  it. A match from an anchor is then extended backward, too.
+*/
+static int flz4_compress(uint32_t* htab, uint32_t* ltab, uint32_t base, const void* input, int length, void* output,
+                         flz_stats* stats) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_start = ip - base;
+  const uint8_t* ip_bound = ip + length - 4; /* because readU32 */
+  const uint8_t* ip_limit = ip + length - 12 - 1;
+  uint8_t* op = (uint8_t*)output;
+
+  uint32_t seq, hash;
+
+  /* initializes long-range hash table */
+  for (hash = 0; hash < LR_HASH_SIZE; ++hash) ltab[hash] = base;
+
+  /* we start with literal copy */
+  const uint8_t* anchor = ip;
+  ip += 2;
+
+  /* main loop */
+  while (FASTLZ_LIKELY(ip < ip_limit)) {
+    const uint8_t* ref;
+    uint32_t distance;
+
+    /* find potential match */
+    while (1) {
+      seq = flz_readu32(ip);
+      hash = flz_hash(seq & 0xffffff);
+      ref = ip_start + htab[hash];
+      htab[hash] = ip - ip_start;
+      distance = ip - ref;
+      if (distance <= MAX_L3_DISTANCE && ((flz_readu32(ref) ^ seq) & 0xffffff) == 0) {
+        /* far, needs at least 4-byte match */
+        if (distance <= MAX_L3_NEAR || ref[3] == ip[3]) {
+          FLZ_STATS(stats->hash_hits++);
+          break;
+        }
+        FLZ_STATS(stats->hash_collisions++);
+      } else {
+        FLZ_STATS(if (distance > MAX_L3_DISTANCE) stats->hash_misses++; else stats->hash_collisions++);
+      }
+
+      if (FASTLZ_UNLIKELY((hash & LR_ANCHOR_MASK) == 0)) {
+        uint32_t next = flz_readu32(ip + 4);
+        uint32_t lhash = flz_lr_hash(seq, next);
+        ref = ip_start + ltab[lhash];
+        ltab[lhash] = ip - ip_start;
+        distance = ip - ref;
+        if (distance > MAX_L3_DISTANCE && distance <= MAX_L4_DISTANCE && flz_readu32(ref) == seq &&
+            flz_readu32(ref + 4) == next) {
+          /* the repeat probably started before this anchor */
+          while (ip > anchor && ref > (const uint8_t*)input && ip[-1] == ref[-1]) {
+            --ip;
+            --ref;
+          }
+          break;
+        }
+      }
+
+      if (FASTLZ_UNLIKELY(++ip >= ip_limit)) break;
+    }
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+
+    if (FASTLZ_LIKELY(ip > anchor)) {
+      FLZ_STATS(stats->literal_runs++; stats->literal_bytes += ip - anchor);
+      op = flz_literals(ip - anchor, anchor, op);
+    }
+
+    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
+    op = flz4_match(len, distance, op);
+    FLZ_STATS(flz_stats_match(stats, len + 2, distance > MAX_L3_NEAR); stats->bytes_skipped += len - 1);
+
+    /* update the hash at match boundary */
+    ip += len;
+    seq = flz_readu32(ip);
+    hash = flz_hash(seq & 0xffffff);
+    htab[hash] = ip++ - ip_start;
+    seq >>= 8;
+    hash = flz_hash(seq);
+    htab[hash] = ip++ - ip_start;
+
+    anchor = ip;
+  }
+
+  uint32_t copy = (uint8_t*)input + length - anchor;
+  FLZ_STATS(if (copy > 0) stats->literal_runs++; stats->literal_bytes += copy);
+  op = flz_literals(copy, anchor, op);
+
+  /* marker for fastlz4 */
+  *(uint8_t*)output |= (3 << 5);
+
+  return op - (uint8_t*)output;
+}
+
+static int fastlz4_compress(const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t ltab[LR_HASH_SIZE];
+  uint32_t hash;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  return flz4_compress(htab, ltab, 0, input, length, output, 0);
+}
+
+static int fastlz4_decompress(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + maxout;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint8_t code;
+      if (len == 7 - 1) do {
+          FASTLZ_BOUND_CHECK(ip < ip_limit);
+          code = *ip++;
+          len += code;
+        } while (code == 255);
+      uint32_t far = (ctrl >> 4) & 1;
+      uint32_t wide = (ctrl >> 3) & far;
+      FASTLZ_BOUND_CHECK(ip + far + wide < ip_limit);
+      uint32_t ofs = ((ctrl & 15) << 8) & (far - 1);
+      ofs += ip[0] + ((ip[far] << 8) & (0 - far)) + ((ip[2 * wide] << 16) & (0 - wide));
+      ip += 1 + far + wide;
+      const uint8_t* ref = op - ofs - 1;
+      len += 3;
+      FASTLZ_BOUND_CHECK(len <= (uint32_t)(op_limit - op));
+      FASTLZ_BOUND_CHECK(ofs < (uint32_t)(op - (uint8_t*)output));
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      ctrl++;
+      FASTLZ_BOUND_CHECK(op + ctrl <= op_limit);
+      FASTLZ_BOUND_CHECK(ip + ctrl <= ip_limit);
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
+      ip += ctrl;
+      op += ctrl;
+    }
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
+}
+
+static int fastlz4_decompress_trusted(const void* input, int length, void* output, int outlen) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + outlen;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint8_t code;
+      if (len == 7 - 1) do {
+          code = *ip++;
+          len += code;
+        } while (code == 255);
+      uint32_t far = (ctrl >> 4) & 1;
+      uint32_t wide = (ctrl >> 3) & far;
+      uint32_t ofs = ((ctrl & 15) << 8) & (far - 1);
+      ofs += ip[0] + ((ip[far] << 8) & (0 - far)) + ((ip[2 * wide] << 16) & (0 - wide));
+      ip += 1 + far + wide;
+      const uint8_t* ref = op - ofs - 1;
+      len += 3;
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      ctrl++;
+      if (FASTLZ_LIKELY(op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, ctrl);
+      ip += ctrl;
+      op += ctrl;
+    }
+
+    if (FASTLZ_UNLIKELY(op >= op_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
+}
+
+/*
+  Level 5 is level 3 with a longer encoding for literal runs: a run of 32
+  bytes or more has 31 in the opcode, followed by the rest of the run
+  length in the same way as the match length in level 2. A long stretch of
+  incompressible data is thus a single literal run.
+*/
+static uint8_t* flz5_literals(uint32_t runs, const uint8_t* src, uint8_t* dest) {
+  if (runs < MAX_COPY) {
+    *dest++ = runs - 1;
+    flz_smallcopy(dest, src, runs);
+    return dest + runs;
+  }
+  *dest++ = MAX_COPY - 1;
+  {
+    uint32_t len = runs - MAX_COPY;
+    for (; len >= 255; len -= 255) *dest++ = 255;
+    *dest++ = len;
+  }
+  fastlz_memcpy(dest, src, runs);
+  return dest + runs;
+}
+
+static int flz5_compress(uint32_t* htab, uint32_t base, const void* input, int length, void* output,
+                         flz_stats* stats) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_start = ip - base;
+  const uint8_t* ip_bound = ip + length - 4; /* because readU32 */
+  const uint8_t* ip_limit = ip + length - 12 - 1;
+  uint8_t* op = (uint8_t*)output;
+
+  uint32_t seq, hash;
+
+  /* we start with literal copy */
+  const uint8_t* anchor = ip;
+  ip += 2;
+
+  /* main loop */
+  while (FASTLZ_LIKELY(ip < ip_limit)) {
+    const uint8_t* ref;
+    uint32_t distance, cmp;
+
+    /* find potential match */
+    do {
+      seq = flz_readu32(ip) & 0xffffff;
+      hash = flz_hash(seq);
+      ref = ip_start + htab[hash];
+      htab[hash] = ip - ip_start;
+      distance = ip - ref;
+      cmp = FASTLZ_LIKELY(distance <= MAX_L3_DISTANCE) ? flz_readu32(ref) & 0xffffff : 0x1000000;
+      FLZ_STATS(if (cmp > 0xffffff) stats->hash_misses++; else if (seq != cmp) stats->hash_collisions++;
+                else stats->hash_hits++);
+      if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+      ++ip;
+    } while (seq != cmp);
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    --ip;
+
+    /* far, needs at least 4-byte match */
+    if (distance > MAX_L3_NEAR && ref[3] != ip[3]) {
+      FLZ_STATS(stats->hash_hits--; stats->hash_collisions++);
+      ++ip;
+      continue;
+    }
+
+    if (FASTLZ_LIKELY(ip > anchor)) {
+      FLZ_STATS(stats->literal_runs++; stats->literal_bytes += ip - anchor);
+      op = flz5_literals(ip - anchor, anchor, op);
+    }
+
+    uint32_t len = flz_cmp(ref + 3, ip + 3, ip_bound);
+    op = flz3_match(len, distance, op);
+    FLZ_STATS(flz_stats_match(stats, len + 2, distance > MAX_L3_NEAR); stats->bytes_skipped += len - 1);
+
+    /* update the hash at match boundary */
+    ip += len;
+    seq = flz_readu32(ip);
+    hash = flz_hash(seq & 0xffffff);
+    htab[hash] = ip++ - ip_start;
+    seq >>= 8;
+    hash = flz_hash(seq);
+    htab[hash] = ip++ - ip_start;
+
+    anchor = ip;
+  }
+
+  uint32_t copy = (uint8_t*)input + length - anchor;
+  FLZ_STATS(if (copy > 0) stats->literal_runs++; stats->literal_bytes += copy);
+  op = flz5_literals(copy, anchor, op);
+
+  /* marker for fastlz5 */
+  *(uint8_t*)output |= (4 << 5);
+
+  return op - (uint8_t*)output;
+}
+
+static int fastlz5_compress(const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  return flz5_compress(htab, 0, input, length, output, 0);
+}
+static int fastlz5_decompress(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + maxout;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 15) << 8;
+      if (len == 7 - 1) {
+        FASTLZ_BOUND_CHECK(ip < ip_limit);
+        len += *ip++;
+      }
+      uint32_t far = (ctrl >> 4) & 1;
+      FASTLZ_BOUND_CHECK(ip + far < ip_limit);
+      ofs += ip[0] + ((ip[far] << 8) & (0 - far));
+      ip += 1 + far;
+      const uint8_t* ref = op - ofs - 1;
+      len += 3;
+      FASTLZ_BOUND_CHECK(op + len <= op_limit);
+      FASTLZ_BOUND_CHECK(ref >= (uint8_t*)output);
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      uint32_t run = ctrl + 1;
+      if (ctrl == 31) {
+        uint8_t code;
+        do {
+          FASTLZ_BOUND_CHECK(ip < ip_limit);
+          code = *ip++;
+          run += code;
+        } while (code == 255);
+      }
+      FASTLZ_BOUND_CHECK(run <= (uint32_t)(op_limit - op));
+      FASTLZ_BOUND_CHECK(run <= (uint32_t)(ip_limit - ip));
+      if (FASTLZ_LIKELY(run <= MAX_COPY && op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, run);
+      ip += run;
+      op += run;
+    }
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
+}
+static int fastlz5_decompress_trusted(const void* input, int length, void* output, int outlen) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + outlen;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 15) << 8;
+      if (len == 7 - 1) len += *ip++;
+      uint32_t far = (ctrl >> 4) & 1;
+      ofs += ip[0] + ((ip[far] << 8) & (0 - far));
+      ip += 1 + far;
+      const uint8_t* ref = op - ofs - 1;
+      len += 3;
+      if (FASTLZ_LIKELY(len <= MAX_COPY && op - ref >= MAX_COPY && op + MAX_COPY <= op_limit))
+        flz_maxcopy(op, ref);
+      else
+        fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      uint32_t run = ctrl + 1;
+      if (ctrl == 31) {
+        uint8_t code;
+        do {
+          code = *ip++;
+          run += code;
+        } while (code == 255);
+      }
+      if (FASTLZ_LIKELY(run <= MAX_COPY && op + MAX_COPY <= op_limit && ip + MAX_COPY <= ip_limit))
+        flz_maxcopy(op, ip);
+      else
+        fastlz_memcpy(op, ip, run);
+      ip += run;
+      op += run;
+    }
+
+    if (FASTLZ_UNLIKELY(op >= op_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return op - (uint8_t*)output;
+}
+
+#define HUFF_BITS 11
+#define HUFF_SIZE (1 << HUFF_BITS)
+#define HUFF_MASK (HUFF_SIZE - 1)
+#define HUFF_HEADER 9
+#define HUFF_LENGTHS 128 /* 256 code lengths, 4 bits each */
+#define MIN_L6_LENGTH 1024
+
+static uint32_t flz_read32le(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static void flz_write32le(uint8_t* p, uint32_t v) {
+  p[0] = v & 255;
+  p[1] = (v >> 8) & 255;
+  p[2] = (v >> 16) & 255;
+  p[3] = v >> 24;
+}
+
+static uint64_t flz_read64le(const uint8_t* p) {
+#if defined(FLZ_ARCH64)
+  return *(const uint64_t*)p;
+#else
+  return flz_read32le(p) | ((uint64_t)flz_read32le(p + 4) << 32);
+#endif
+}
+
+/*
+  Huffman code lengths, at most HUFF_BITS, for the 256 byte values. The
+  optimal lengths are computed in place (Moffat and Katajainen) over the
+  used symbols sorted by frequency, then the longest codes are clamped and
+  the Kraft inequality is restored by lengthening the rarest shorter codes.
+*/
+static void flz_huff_lengths(const uint32_t* freq, uint8_t* lengths) {
+  uint32_t a[256];
+  int sym[256];
+  int n = 0;
+  int i, j, root, leaf, next, avbl, used, dpth;
+  uint32_t kraft;
+
+  for (i = 0; i < 256; ++i) {
+    lengths[i] = 0;
+    if (freq[i] == 0) continue;
+    for (j = n++; j > 0 && freq[sym[j - 1]] > freq[i]; --j) sym[j] = sym[j - 1];
+    sym[j] = i;
+  }
+  if (n == 0) return;
+  if (n == 1) {
+    lengths[sym[0]] = 1;
+    return;
+  }
+  for (i = 0; i < n; ++i) a[i] = freq[sym[i]];
+
+  /* parent pointers, left to right */
+  a[0] += a[1];
+  root = 0;
+  leaf = 2;
+  for (next = 1; next < n - 1; ++next) {
+    if (leaf >= n || a[root] < a[leaf]) {
+      a[next] = a[root];
+      a[root++] = next;
+    } else {
+      a[next] = a[leaf++];
+    }
+    if (leaf >= n || (root < next && a[root] < a[leaf])) {
+      a[next] += a[root];
+      a[root++] = next;
+    } else {
+      a[next] += a[leaf++];
+    }
+  }
+
+  /* depths of the internal nodes, right to left */
+  a[n - 2] = 0;
+  for (next = n - 3; next >= 0; --next) a[next] = a[a[next]] + 1;
+
+  /* depths of the leaves */
+  avbl = 1;
+  used = dpth = 0;
+  root = n - 2;
+  next = n - 1;
+  while (avbl > 0) {
+    while (root >= 0 && (int)a[root] == dpth) {
+      ++used;
+      --root;
+    }
+    while (avbl > used) {
+      a[next--] = dpth;
+      --avbl;
+    }
+    avbl = 2 * used;
+    ++dpth;
+    used = 0;
+  }
+
+  /* limit the lengths, a[0] being the rarest symbol */
+  kraft = 0;
+  for (i = 0; i < n; ++i) {
+    if (a[i] > HUFF_BITS) a[i] = HUFF_BITS;
+    kraft += 1 << (HUFF_BITS - a[i]);
+  }
+  while (kraft > HUFF_SIZE) {
+    for (i = 0; a[i] == HUFF_BITS; ++i)
+      ;
+    ++a[i];
+    kraft -= 1 << (HUFF_BITS - a[i]);
+  }
+  for (i = n - 1; i >= 0; --i)
+    while (a[i] > 1 && kraft + (1 << (HUFF_BITS - a[i])) <= HUFF_SIZE) {
+      kraft += 1 << (HUFF_BITS - a[i]);
+      --a[i];
+    }
+
+  for (i = 0; i < n; ++i) lengths[sym[i]] = a[i];
+}
+
+/* canonical codes, bit-reversed since the bit stream is read from the least-significant bit */
+static void flz_huff_codes(const uint8_t* lengths, uint16_t* codes) {
+  uint32_t count[HUFF_BITS + 1];
+  uint32_t next[HUFF_BITS + 1];
+  uint32_t code = 0;
+  int i, k;
+
+  for (i = 0; i <= HUFF_BITS; ++i) count[i] = 0;
+  for (i = 0; i < 256; ++i) count[lengths[i]]++;
+  count[0] = 0;
+  for (i = 1; i <= HUFF_BITS; ++i) {
+    code = (code + count[i - 1]) << 1;
+    next[i] = code;
+  }
+  for (i = 0; i < 256; ++i) {
+    uint32_t len = lengths[i];
+    uint32_t rev = 0;
+    if (len == 0) continue;
+    code = next[len]++;
+    for (k = 0; k < (int)len; ++k) rev |= ((code >> k) & 1) << (len - 1 - k);
+    codes[i] = rev;
+  }
+}
+
+/*
+  Every entry of the decoding table is indexed by the next HUFF_BITS bits
+  and holds up to two symbols (bits 0-15), the number of bits they take
+  (bits 16-23), the number of symbols (bits 24-27), and the length of the
+  first symbol (bits 28-31). Bit patterns which are not a valid code decode
+  as one symbol taking HUFF_BITS bits, so that a corrupted stream can not
+  stall the decoder.
+*/
+static void flz_huff_table(const uint8_t* lengths, uint32_t* table) {
+  uint16_t single[HUFF_SIZE];
+  uint16_t codes[256];
+  uint32_t i, j;
+
+  flz_huff_codes(lengths, codes);
+  for (i = 0; i < HUFF_SIZE; ++i) single[i] = 0;
+  for (i = 0; i < 256; ++i)
+    if (lengths[i] > 0)
+      for (j = codes[i]; j < HUFF_SIZE; j += 1 << lengths[i]) single[j] = i | (lengths[i] << 8);
+
+  for (i = 0; i < HUFF_SIZE; ++i) {
+    uint32_t first = single[i];
+    uint32_t len = first >> 8;
+    if (len == 0) {
+      table[i] = ((uint32_t)HUFF_BITS << 28) | (1 << 24) | (HUFF_BITS << 16);
+    } else {
+      uint32_t second = single[i >> len];
+      uint32_t len2 = second >> 8;
+      if (len2 > 0 && len + len2 <= HUFF_BITS)
+        table[i] = (len << 28) | (2 << 24) | ((len + len2) << 16) | ((second & 255) << 8) | (first & 255);
+      else
+        table[i] = (len << 28) | (1 << 24) | (len << 16) | (first & 255);
+    }
+  }
+}
+
+/* skips one match in a level 2 opcode stream, returns its length */
+static const uint8_t* flz_skip_match(const uint8_t* ip, uint32_t ctrl, uint32_t* len) {
+  uint8_t code;
+  *len = (ctrl >> 5) + 2;
+  if ((ctrl >> 5) == 7) do {
+      code = *ip++;
+      *len += code;
+    } while (code == 255);
+  code = *ip++;
+  if (code == 255 && (ctrl & 31) == 31) ip += 2;
+  return ip;
+}
+
+static uint8_t* flz6_literals(uint32_t runs, uint8_t* op) {
+  if (runs < MAX_COPY) {
+    *op++ = runs - 1;
+  } else {
+    *op++ = MAX_COPY - 1;
+    for (runs -= MAX_COPY; runs >= 255; runs -= 255) *op++ = 255;
+    *op++ = runs;
+  }
+  return op;
+}
+
+/*
+  Level 6 splits a level 2 block into the opcodes (where a literal run
+  opcode is followed by the run length as in level 5, but not by the
+  literals) and the literals, which are Huffman-coded as a whole:
+
+    byte 0       (5 << 5), plus 1 if the literals are Huffman-coded
+    bytes 1-4    number of literals
+    bytes 5-8    size of the opcodes
+    128 bytes    code lengths, 4 bits each, only when Huffman-coded
+    opcodes
+    literals     as they are, or Huffman-coded from the least-significant bit
+
+  The level 2 block is transformed in place within the output buffer, the
+  literals being taken from the input again.
+*/
+static int flz6_compress(uint32_t* htab, const void* input, int length, void* output, flz_stats* stats) {
+  const uint8_t* in = (const uint8_t*)input;
+  uint8_t* out = (uint8_t*)output;
+  uint32_t freq[256];
+  uint8_t lengths[256];
+  uint32_t size = flz2_compress(htab, 0, 0, input, length, output, stats);
+  const uint8_t* ip = out;
+  const uint8_t* ip_limit = out + size;
+  uint8_t* op = out;
+  uint32_t pos = 0;
+  uint32_t run = 0;
+  uint32_t nlit = 0;
+  uint32_t ops, bits, header, i;
+  uint32_t ctrl = (*ip++) & 31;
+
+  for (i = 0; i < 256; ++i) freq[i] = 0;
+
+  /* drop the literals, merge the literal runs */
+  while (1) {
+    if (ctrl >= 32) {
+      const uint8_t* start = ip - 1;
+      uint32_t len;
+      ip = flz_skip_match(ip, ctrl, &len);
+      if (run > 0) op = flz6_literals(run, op);
+      run = 0;
+      while (start < ip) *op++ = *start++;
+      pos += len;
+    } else {
+      ctrl++;
+      for (i = 0; i < ctrl; ++i) freq[in[pos + i]]++;
+      ip += ctrl;
+      pos += ctrl;
+      run += ctrl;
+      nlit += ctrl;
+    }
+    if (ip >= ip_limit) break;
+    ctrl = *ip++;
+  }
+  if (run > 0) op = flz6_literals(run, op);
+  ops = op - out;
+
+  /* estimated size of the Huffman-coded literals */
+  flz_huff_lengths(freq, lengths);
+  bits = 0;
+  for (i = 0; i < 256; ++i) bits += freq[i] * lengths[i];
+  header = HUFF_HEADER;
+  if (nlit > 0 && HUFF_LENGTHS + (bits + 7) / 8 < nlit) header += HUFF_LENGTHS;
+
+  for (i = ops; i > 0; --i) out[header + i - 1] = out[i - 1];
+  out[0] = (5 << 5) | (header > HUFF_HEADER);
+  flz_write32le(out + 1, nlit);
+  flz_write32le(out + 5, ops);
+  if (header > HUFF_HEADER)
+    for (i = 0; i < HUFF_LENGTHS; ++i) out[HUFF_HEADER + i] = lengths[2 * i] | (lengths[2 * i + 1] << 4);
+
+  /* walk the opcodes again and append the literals */
+  {
+    uint16_t codes[256];
+    uint64_t acc = 0;
+    uint32_t count = 0;
+    const uint8_t* oq = out + header;
+    const uint8_t* oq_limit = oq + ops;
+    uint8_t* lp = out + header + ops;
+
+    if (header > HUFF_HEADER) flz_huff_codes(lengths, codes);
+    pos = 0;
+    while (oq < oq_limit) {
+      uint32_t len;
+      ctrl = *oq++;
+      if (ctrl >= 32) {
+        oq = flz_skip_match(oq, ctrl, &len);
+        pos += len;
+        continue;
+      }
+      len = ctrl + 1;
+      if (ctrl == 31) {
+        uint8_t code;
+        do {
+          code = *oq++;
+          len += code;
+        } while (code == 255);
+      }
+      if (header == HUFF_HEADER) {
+        fastlz_memcpy(lp, in + pos, len);
+        lp += len;
+        pos += len;
+        continue;
+      }
+      for (; len > 0; --len) {
+        uint32_t c = in[pos++];
+        acc |= (uint64_t)codes[c] << count;
+        count += lengths[c];
+        if (count >= 32) {
+          flz_write32le(lp, (uint32_t)acc);
+          lp += 4;
+          acc >>= 32;
+          count -= 32;
+        }
+      }
+    }
+    for (; count > 0; count = (count > 8) ? count - 8 : 0) {
+      *lp++ = acc & 255;
+      acc >>= 8;
+    }
+    return lp - out;
+  }
+}
+
+static int fastlz6_compress(const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash;
+
+  /* not worth it for short block */
+  if (length < MIN_L6_LENGTH) return fastlz2_compress(input, length, output);
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  return flz6_compress(htab, input, length, output, 0);
+}
+
+/* at least 56 bits in the buffer, zeros past the end of the input */
+static uint32_t flz_huff_refill(const uint8_t* input, uint32_t size, uint32_t* pos, uint64_t* bits, uint32_t avail) {
+  if (FASTLZ_LIKELY(*pos + 8 <= size)) {
+    *bits |= flz_read64le(input + *pos) << avail;
+    *pos += (63 - avail) >> 3;
+    return avail | 56;
+  }
+  for (; avail <= 56; avail += 8, ++*pos)
+    if (*pos < size) *bits |= (uint64_t)input[*pos] << avail;
+  return avail;
+}
+
+/* decodes count literals, returns 0 if the bit stream is too short */
+static int flz_huff_decode(const uint32_t* table, const uint8_t* input, uint32_t size, uint8_t* output,
+                           uint32_t count) {
+  uint8_t* op = output;
+  uint8_t* op_limit = output + count;
+  uint64_t bits = 0;
+  uint32_t avail = 0;
+  uint32_t pos = 0;
+  uint32_t e;
+
+  /* 4 entries, up to 8 symbols, per refill */
+  while (FASTLZ_LIKELY(op_limit - op >= 8)) {
+    avail = flz_huff_refill(input, size, &pos, &bits, avail);
+    e = table[bits & HUFF_MASK];
+    op[0] = e & 255;
+    op[1] = (e >> 8) & 255;
+    op += (e >> 24) & 15;
+    bits >>= (e >> 16) & 255;
+    avail -= (e >> 16) & 255;
+    e = table[bits & HUFF_MASK];
+    op[0] = e & 255;
+    op[1] = (e >> 8) & 255;
+    op += (e >> 24) & 15;
+    bits >>= (e >> 16) & 255;
+    avail -= (e >> 16) & 255;
+    e = table[bits & HUFF_MASK];
+    op[0] = e & 255;
+    op[1] = (e >> 8) & 255;
+    op += (e >> 24) & 15;
+    bits >>= (e >> 16) & 255;
+    avail -= (e >> 16) & 255;
+    e = table[bits & HUFF_MASK];
+    op[0] = e & 255;
+    op[1] = (e >> 8) & 255;
+    op += (e >> 24) & 15;
+    bits >>= (e >> 16) & 255;
+    avail -= (e >> 16) & 255;
+  }
+
+  /* the last few, one symbol at a time */
+  while (op < op_limit) {
+    avail = flz_huff_refill(input, size, &pos, &bits, avail);
+    e = table[bits & HUFF_MASK];
+    *op++ = e & 255;
+    bits >>= e >> 28;
+    avail -= e >> 28;
+  }
+
+  /* consumed more bits than available? */
+  return pos <= size || (pos - size) * 8 <= avail;
+}
+
+static int fastlz6_decompress(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit;
+  const uint8_t* ip_bound;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + maxout;
+  const uint8_t* lit;
+  const uint8_t* lit_limit;
+  uint32_t nlit, ops, header, ctrl;
+  int staged;
+
+  FASTLZ_BOUND_CHECK(length >= HUFF_HEADER);
+  staged = ip[0] & 1;
+  header = HUFF_HEADER + (staged ? HUFF_LENGTHS : 0);
+  nlit = flz_read32le(ip + 1);
+  ops = flz_read32le(ip + 5);
+  FASTLZ_BOUND_CHECK(header <= (uint32_t)length && ops <= length - header);
+  ip_limit = ip + header + ops;
+  ip_bound = ip_limit - 2;
+
+  if (staged) {
+    /* Huffman-decode the literals to the end of the output buffer */
+    uint32_t table[HUFF_SIZE];
+    uint8_t lengths[256];
+    uint32_t i;
+    FASTLZ_BOUND_CHECK(nlit <= (uint32_t)maxout);
+    for (i = 0; i < HUFF_LENGTHS; ++i) {
+      lengths[2 * i] = ip[HUFF_HEADER + i] & 15;
+      lengths[2 * i + 1] = ip[HUFF_HEADER + i] >> 4;
+      FASTLZ_BOUND_CHECK(lengths[2 * i] <= HUFF_BITS && lengths[2 * i + 1] <= HUFF_BITS);
+    }
+    flz_huff_table(lengths, table);
+    lit = op_limit - nlit;
+    FASTLZ_BOUND_CHECK(flz_huff_decode(table, ip_limit, length - header - ops, (uint8_t*)lit, nlit));
+  } else {
+    FASTLZ_BOUND_CHECK(nlit <= length - header - ops);
+    lit = ip_limit;
+  }
+  lit_limit = lit + nlit;
+
+  ip += header;
+  while (ip < ip_limit) {
+    ctrl = *ip++;
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 31) << 8;
+      const uint8_t* ref = op - ofs - 1;
+
+      uint8_t code;
+      if (len == 7 - 1) do {
+          FASTLZ_BOUND_CHECK(ip <= ip_bound);
+          code = *ip++;
+          len += code;
+        } while (code == 255);
+      FASTLZ_BOUND_CHECK(ip < ip_limit);
+      code = *ip++;
+      ref -= code;
+      len += 3;
+
+      /* match from 16-bit distance */
+      if (FASTLZ_UNLIKELY(code == 255))
+        if (FASTLZ_LIKELY(ofs == (31 << 8))) {
+          FASTLZ_BOUND_CHECK(ip < ip_bound);
+          ofs = (*ip++) << 8;
+          ofs += *ip++;
+          ref = op - ofs - MAX_L2_DISTANCE - 1;
+        }
+
+      FASTLZ_BOUND_CHECK(op + len <= op_limit);
+      FASTLZ_BOUND_CHECK(ref >= (uint8_t*)output);
+      fastlz_memmove(op, ref, len);
+      op += len;
+    } else {
+      uint32_t run = ctrl + 1;
+      if (ctrl == 31) {
+        uint8_t code;
+        do {
+          FASTLZ_BOUND_CHECK(ip < ip_limit);
+          code = *ip++;
+          run += code;
+        } while (code == 255);
+      }
+      FASTLZ_BOUND_CHECK(run <= (uint32_t)(op_limit - op));
+      FASTLZ_BOUND_CHECK(run <= (uint32_t)(lit_limit - lit));
+
+      /* the staged literals are ahead, possibly overlapping near the end */
+      if (staged && lit < op + run) {
+        uint32_t i;
+        for (i = 0; i < run; ++i) op[i] = lit[i];
+      } else {
+        fastlz_memcpy(op, lit, run);
+      }
+      lit += run;
+      op += run;
+    }
+  }
+
+  return op - (uint8_t*)output;
+}
+
+/*
+  For every 256-byte chunk of the concatenated stream, the segment which
+  contains the start of that chunk, so that the segment of any position
+  within the window can be found right away.
+*/
+#define SEGMAP_LOG 8
+#define SEGMAP_SIZE 1024 /* covers 256 KB, more than MAX_FARDISTANCE */
+#define SEGMAP_MASK (SEGMAP_SIZE - 1)
+
+typedef struct {
+  uint32_t index[SEGMAP_SIZE];
+  uint32_t pos[SEGMAP_SIZE];
+} flz_segmap;
+
+static void flz_segmap_add(flz_segmap* map, int s, uint32_t seg_pos, uint32_t seg_len) {
+  uint32_t chunk = (seg_pos + (1 << SEGMAP_LOG) - 1) >> SEGMAP_LOG;
+  uint32_t last = (seg_pos + seg_len - 1) >> SEGMAP_LOG;
+  for (; chunk <= last; ++chunk) {
+    map->index[chunk & SEGMAP_MASK] = s;
+    map->pos[chunk & SEGMAP_MASK] = seg_pos;
+  }
+}
+
+/* locate pos, a position before the current segment */
+static const uint8_t* flz_segmap_ref(const flz_segmap* map, const struct fastlz_iovec* iov, uint32_t pos,
+                                     const uint8_t** ref_end) {
+  uint32_t s = map->index[(pos >> SEGMAP_LOG) & SEGMAP_MASK];
+  uint32_t seg_pos = map->pos[(pos >> SEGMAP_LOG) & SEGMAP_MASK];
+  const uint8_t* ref;
+  while (pos >= seg_pos + iov[s].iov_len) seg_pos += iov[s++].iov_len;
+  ref = (const uint8_t*)iov[s].iov_base + (pos - seg_pos);
+  *ref_end = (const uint8_t*)iov[s].iov_base + iov[s].iov_len;
+  return (ref + 8 <= *ref_end) ? ref : 0;
+}
+
+/*
+  Same as fastlz1_compress and fastlz2_compress, except that the input is
+  the concatenation of all the segments. The hash table holds logical
+  positions (i.e. offsets in the concatenated stream), hence a match can
+  refer to any of the previous segments. Only the match itself can not
+  extend past the end of its segment.
+
+  Every hash table entry also keeps the sequence found at that position, so
+  that the candidate can be rejected without locating its segment.
+*/
+static int flz_compressv(int level, const struct fastlz_iovec* iov, int iovcnt, void* output) {
+  uint8_t* op = (uint8_t*)output;
+  uint32_t max_distance = (level == 1) ? MAX_L1_DISTANCE : MAX_FARDISTANCE;
+  uint32_t seg_pos = 0;
+  int s;
+
+  flz_segmap segmap;
+  uint32_t htab[HASH_SIZE][2];
+  uint32_t seq, hash;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) {
+    htab[hash][0] = 0;
+    htab[hash][1] = 0x1000000; /* never a valid sequence */
+  }
+
+  for (s = 0; s < iovcnt; ++s) {
+    const uint8_t* seg = (const uint8_t*)iov[s].iov_base;
+    uint32_t seg_len = iov[s].iov_len;
+    const uint8_t* ip = seg;
+    const uint8_t* ip_start = seg - seg_pos; /* logical position 0 */
+    const uint8_t* ip_bound = seg + seg_len - 4; /* because readU32 */
+    const uint8_t* ip_limit = seg + seg_len - 12 - 1;
+    const uint8_t* anchor = seg;
+
+    if (seg_len == 0) continue;
+    flz_segmap_add(&segmap, s, seg_pos, seg_len);
+
+    /* the very first instruction must be a literal copy */
+    if (op == (uint8_t*)output) ip += 2;
+
+    /* main loop */
+    while (seg_len > 12 + 1 && FASTLZ_LIKELY(ip < ip_limit)) {
+      const uint8_t* ref;
+      const uint8_t* ref_end = 0;
+      uint32_t distance, cmp, len;
+
+      /* find potential match */
+      do {
+        seq = flz_readu32(ip) & 0xffffff;
+        hash = flz_hash(seq);
+        distance = (ip - ip_start) - htab[hash][0];
+        cmp = htab[hash][1];
+        htab[hash][0] = ip - ip_start;
+        htab[hash][1] = seq;
+        if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+        ++ip;
+      } while (seq != cmp || distance >= max_distance);
+
+      if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+      --ip;
+
+      ref = ip - distance;
+      if (FASTLZ_UNLIKELY(ref < seg)) {
+        ref = flz_segmap_ref(&segmap, iov, (ip - ip_start) - distance, &ref_end);
+        if (!ref) {
+          ++ip;
+          continue;
+        }
+      }
+
+      /* far, needs at least 5-byte match */
+      if (level == 2 && distance >= MAX_L2_DISTANCE) {
+        if (ref[3] != ip[3] || ref[4] != ip[4]) {
+          ++ip;
+          continue;
+        }
+      }
+
+      if (FASTLZ_LIKELY(ip > anchor)) {
+        op = flz_literals(ip - anchor, anchor, op);
+      }
+
+      /* the match can not go beyond the segment of the reference either */
+      if (FASTLZ_UNLIKELY(ref_end && ref_end - ref < ip_bound - ip))
+        len = flz_cmp(ref + 3, ip + 3, ip + (ref_end - ref));
+      else
+        len = flz_cmp(ref + 3, ip + 3, ip_bound);
+      op = (level == 1) ? flz1_match(len, distance, op) : flz2_match(len, distance, op);
+
+      /* update the hash at match boundary */
+      ip += len;
+      seq = flz_readu32(ip);
+      hash = flz_hash(seq & 0xffffff);
+      htab[hash][0] = ip++ - ip_start;
+      htab[hash][1] = seq & 0xffffff;
+      seq >>= 8;
+      hash = flz_hash(seq);
+      htab[hash][0] = ip++ - ip_start;
+      htab[hash][1] = seq;
+
+      anchor = ip;
+    }
+
+    op = flz_literals(seg + seg_len - anchor, anchor, op);
+    seg_pos += seg_len;
+  }
+
+  /* marker for fastlz2 */
+  if (level == 2) *(uint8_t*)output |= (1 << 5);
+
+  return op - (uint8_t*)output;
+}
+
+/* copy count bytes into the pages, starting at the logical position pos */
+static void flz_pages_write(uint8_t* const* pages, uint32_t shift, uint32_t pos, const uint8_t* src,
+                            uint32_t count) {
+  uint32_t mask = (1 << shift) - 1;
+  while (count > 0) {
+    uint32_t room = mask + 1 - (pos & mask);
+    uint32_t chunk = (count < room) ? count : room;
+    fastlz_memcpy(pages[pos >> shift] + (pos & mask), src, chunk);
+    src += chunk;
+    pos += chunk;
+    count -= chunk;
+  }
+}
+
+/*
+  Copy count bytes within the pages, from distance bytes back, to the
+  logical position pos. The copy is split at every page boundary (of the
+  source and of the destination). A piece which straddles two pages can
+  never overlap with itself, since it is never longer than distance.
+*/
+static void flz_pages_copy(uint8_t* const* pages, uint32_t shift, uint32_t pos, uint32_t distance, uint32_t count) {
+  uint32_t mask = (1 << shift) - 1;
+  uint32_t ref = pos - distance;
+  while (count > 0) {
+    uint32_t room = mask + 1 - (pos & mask);
+    uint32_t ref_room = mask + 1 - (ref & mask);
+    uint32_t chunk = (count < room) ? count : room;
+    if (chunk > ref_room) chunk = ref_room;
+    fastlz_memmove(pages[pos >> shift] + (pos & mask), pages[ref >> shift] + (ref & mask), chunk);
+    pos += chunk;
+    ref += chunk;
+    count -= chunk;
+  }
+}
+
+static int flz_decompress_pages(int level, const void* input, int length, uint8_t* const* pages, uint32_t shift,
+                                uint32_t npages) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  const uint8_t* ip_bound = ip_limit - 2;
+  uint32_t page_size = 1 << shift;
+  uint32_t maxout = npages << shift;
+  uint32_t page = 0;
+  uint8_t* page_start = pages[0];
+  uint8_t* op = page_start;
+  uint8_t* op_limit = page_start + page_size;
+  uint32_t ctrl = (*ip++) & 31;
+
+  while (1) {
+    uint32_t pos;
+    if (ctrl >= 32) {
+      uint32_t len = (ctrl >> 5) - 1;
+      uint32_t ofs = (ctrl & 31) << 8;
+      uint8_t code;
+      if (level == 1) {
+        if (len == 7 - 1) {
+          FASTLZ_BOUND_CHECK(ip <= ip_bound);
+          len += *ip++;
+        }
+        FASTLZ_BOUND_CHECK(ip < ip_limit);
+        ofs += *ip++;
+      } else if (level == 3) {
+        ofs &= 15 << 8;
+        if (len == 7 - 1) {
+          FASTLZ_BOUND_CHECK(ip < ip_limit);
+          len += *ip++;
+        }
+        FASTLZ_BOUND_CHECK(ip < ip_limit);
+        ofs += *ip++;
+        if (ctrl & 16) {
+          FASTLZ_BOUND_CHECK(ip < ip_limit);
+          ofs += (*ip++) << 8;
+        }
+      } else {
+        if (len == 7 - 1) do {
+            FASTLZ_BOUND_CHECK(ip <= ip_bound);
+            code = *ip++;
+            len += code;
+          } while (code == 255);
+        FASTLZ_BOUND_CHECK(ip < ip_limit);
+        code = *ip++;
+        ofs += code;
+
+        /* match from 16-bit distance */
+        if (FASTLZ_UNLIKELY(ofs == (31 << 8) + 255)) {
+          FASTLZ_BOUND_CHECK(ip < ip_bound);
+          ofs = (*ip++) << 8;
+          ofs += *ip++;
+          ofs += MAX_L2_DISTANCE;
+        }
+      }
+      len += 3;
+
+      /* within the current page */
+      if (FASTLZ_LIKELY(len <= (uint32_t)(op_limit - op) && ofs < (uint32_t)(op - page_start))) {
+        fastlz_memmove(op, op - ofs - 1, len);
+        op += len;
+        goto next;
+      }
+
+      pos = (page << shift) + (op - page_start);
+      FASTLZ_BOUND_CHECK(ofs < pos);
+
+      /* reference entirely within an earlier page */
+      if (FASTLZ_LIKELY(len <= (uint32_t)(op_limit - op))) {
+        uint32_t ref = pos - ofs - 1;
+        uint32_t mask = page_size - 1;
+        if (FASTLZ_LIKELY((ref & mask) + len <= page_size)) {
+          fastlz_memcpy(op, pages[ref >> shift] + (ref & mask), len);
+          op += len;
+          goto next;
+        }
+      }
+
+      FASTLZ_BOUND_CHECK(pos + len <= maxout);
+      flz_pages_copy(pages, shift, pos, ofs + 1, len);
+      pos += len;
+    } else {
+      ctrl++;
+      FASTLZ_BOUND_CHECK(ip + ctrl <= ip_limit);
+
+      /* within the current page */
+      if (FASTLZ_LIKELY(ctrl <= (uint32_t)(op_limit - op))) {
+        fastlz_memcpy(op, ip, ctrl);
+        ip += ctrl;
+        op += ctrl;
+        goto next;
+      }
+
+      pos = (page << shift) + (op - page_start);
+      FASTLZ_BOUND_CHECK(pos + ctrl <= maxout);
+      flz_pages_write(pages, shift, pos, ip, ctrl);
+      ip += ctrl;
+      pos += ctrl;
+    }
+
+    /* move on to the page of the new position (or stay at the very end) */
+    page = pos >> shift;
+    if (page == npages) --page;
+    page_start = pages[page];
+    op = page_start + (pos - (page << shift));
+    op_limit = page_start + page_size;
+
+  next:
+    if (level == 1 && FASTLZ_UNLIKELY(ip > ip_bound)) break;
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    ctrl = *ip++;
+  }
+
+  return (page << shift) + (op - page_start);
+}
+
+/*
+  Specialized for FASTLZ_PAGE_SIZE: the positions within a page fit in
+  16 bits, every reference is near (hence no distance check), and the
+  smaller hash table is cheaper to initialize.
+*/
+#define PAGE_HASH_LOG 12
+#define PAGE_HASH_SIZE (1 << PAGE_HASH_LOG)
+#define PAGE_HASH_MASK (PAGE_HASH_SIZE - 1)
+
+static uint16_t flz_page_hash(uint32_t v) {
+  uint32_t h = (v * 2654435769LL) >> (32 - PAGE_HASH_LOG);
+  return h & PAGE_HASH_MASK;
+}
+
+/* whether the page repeats its first 8 bytes, e.g. all zeros */
+static int flz_page_filled(const uint8_t* page) {
+  uint32_t lo = flz_readu32(page);
+  uint32_t hi = flz_readu32(page + 4);
+  uint32_t i;
+
+  for (i = 0; i < FASTLZ_PAGE_SIZE; i += 32) {
+    uint32_t diff = (flz_readu32(page + i) ^ lo) | (flz_readu32(page + i + 4) ^ hi);
+    diff |= (flz_readu32(page + i + 8) ^ lo) | (flz_readu32(page + i + 12) ^ hi);
+    diff |= (flz_readu32(page + i + 16) ^ lo) | (flz_readu32(page + i + 20) ^ hi);
+    diff |= (flz_readu32(page + i + 24) ^ lo) | (flz_readu32(page + i + 28) ^ hi);
+    if (diff != 0) return 0;
+  }
+  return 1;
+}
+
+static int flz_compress_page(const uint8_t* page, uint8_t* output) {
+  uint16_t htab[PAGE_HASH_SIZE];
+  const uint8_t* ip = page;
+  const uint8_t* ip_bound = ip + FASTLZ_PAGE_SIZE - 4; /* because readU32 */
+  const uint8_t* ip_limit = ip + FASTLZ_PAGE_SIZE - 12 - 1;
+  const uint8_t* anchor = ip;
+  uint8_t* op = output;
+  uint32_t seq, hash;
+
+  /* 8 literals, then a single match repeating them */
+  if (flz_page_filled(page)) {
+    op = flz_literals(8, page, op);
+    op = flz2_match(FASTLZ_PAGE_SIZE - 8 - 2, 8, op);
+    *output |= (1 << 5);
+    return op - output;
+  }
+
+  for (hash = 0; hash < PAGE_HASH_SIZE; ++hash) htab[hash] = 0;
+
+  /* we start with literal copy */
+  ip += 2;
+
+  /* main loop */
+  while (FASTLZ_LIKELY(ip < ip_limit)) {
+    const uint8_t* ref;
+    uint32_t distance, cmp, len;
+
+    /* find potential match */
+    do {
+      seq = flz_readu32(ip) & 0xffffff;
+      hash = flz_page_hash(seq);
+      ref = page + htab[hash];
+      htab[hash] = ip - page;
+      cmp = flz_readu32(ref) & 0xffffff;
+      if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+      ++ip;
+    } while (seq != cmp);
+
+    if (FASTLZ_UNLIKELY(ip >= ip_limit)) break;
+    --ip;
+    distance = ip - ref;
+
+    if (FASTLZ_LIKELY(ip > anchor)) op = flz_literals(ip - anchor, anchor, op);
+
+    len = flz_cmp(ref + 3, ip + 3, ip_bound);
+    op = flz2_match(len, distance, op);
+
+    /* update the hash at match boundary */
+    ip += len;
+    seq = flz_readu32(ip);
+    hash = flz_page_hash(seq & 0xffffff);
+    htab[hash] = ip++ - page;
+    seq >>= 8;
+    hash = flz_page_hash(seq);
+    htab[hash] = ip++ - page;
+
+    anchor = ip;
+  }
+
+  op = flz_literals(page + FASTLZ_PAGE_SIZE - anchor, anchor, op);
+
+  /* marker for fastlz2 */
+  *output |= (1 << 5);
+
+  return op - output;
+}
+
+#define SAMPLE_SIZE 512
+#define SAMPLE_COUNT 8
+#define SAMPLE_HASH_LOG 10
+#define SAMPLE_HASH_SIZE (1 << SAMPLE_HASH_LOG)
+
+#define ADAPTIVE_STORE_RATIO 95
+#define ADAPTIVE_LEVEL2_RATIO 50
+
+/* a shorter match after literals saves a byte or two but slows down decompression */
+#define FASTDECODE_MIN_MATCH 6
+
+/*
+  Estimate the compressed size (in percent of the input size) by running a
+  simplified match finder over a few samples spread across the input: bytes
+  covered by a match cost roughly 2-3 bytes per match, the others are
+  literals (plus one byte for every run of 32).
+*/
+static int flz_estimate(const uint8_t* input, uint32_t length) {
+  uint32_t htab[SAMPLE_HASH_SIZE];
+  uint32_t sample_size = SAMPLE_SIZE;
+  uint32_t count = length / (SAMPLE_SIZE * SAMPLE_COUNT);
+  uint32_t stride;
+  uint32_t literals = 0;
+  uint32_t estimate = 0;
+  uint32_t total = 0;
+  uint32_t hash;
+  uint32_t s;
+
+  if (length < 16) return 100;
+
+  for (hash = 0; hash < SAMPLE_HASH_SIZE; ++hash) htab[hash] = 0;
+
+  /* examine at most 1/8 of the input (but at least one sample) */
+  if (count < 1) count = 1;
+  if (count > SAMPLE_COUNT) count = SAMPLE_COUNT;
+  if (sample_size > length) sample_size = length;
+  stride = length / count;
+
+  for (s = 0; s + sample_size <= length; s += stride) {
+    const uint8_t* ip = input + s;
+    const uint8_t* ip_start = ip;
+    const uint8_t* ip_bound = ip + sample_size - 4;
+    const uint8_t* ip_limit = ip + sample_size - 12;
+
+    while (ip < ip_limit) {
+      uint32_t seq = flz_readu32(ip);
+      const uint8_t* ref;
+      hash = (uint32_t)(seq * 2654435769U) >> (32 - SAMPLE_HASH_LOG);
+      ref = input + htab[hash];
+      htab[hash] = ip - input;
+      if (ref >= ip_start && ref < ip && flz_readu32(ref) == seq) {
+        uint32_t len = 4 + flz_cmp(ref + 4, ip + 4, ip_bound) - 1;
+        estimate += (len > 8) ? 3 : 2;
+        ip += len;
+      } else {
+        ++literals;
+        ++ip;
+      }
+    }
+    literals += ip_start + sample_size - ip;
+    total += sample_size;
+  }
+
+  estimate += literals + (literals + MAX_COPY - 1) / MAX_COPY;
+  return (200 * estimate / total + 1) / 2;
+}
+
+#define FILTERED_TAG 7
+#define FILTER_CHUNK 16384
+
+/*
+  Byte-shuffle and delta filters, applied before compression. Delta works
+  byte-wise against the same byte of the previous element. Shuffle groups
+  the first bytes of all elements, then the second bytes, and so on, within
+  chunks of (at most) FILTER_CHUNK bytes, so that the inverse can be done
+  in place with a small buffer. Trailing bytes not forming a complete
+  element are left untouched.
+*/
+static void flz_filter(int filter, uint32_t elem_size, const uint8_t* src, uint8_t* dest, uint32_t length) {
+  uint32_t count = length / elem_size;
+  uint32_t end = count * elem_size;
+  uint32_t i;
+
+  if (filter & FASTLZ_FILTER_SHUFFLE) {
+    uint32_t chunk_count = FILTER_CHUNK / elem_size;
+    uint32_t first, k, j;
+    for (first = 0; first < count; first += chunk_count) {
+      const uint8_t* p = src + first * elem_size;
+      uint8_t* q = dest + first * elem_size;
+      uint32_t n = (count - first < chunk_count) ? count - first : chunk_count;
+      for (k = 0; k < elem_size; ++k, q += n) {
+        if ((filter & FASTLZ_FILTER_DELTA) && first == 0) {
+          q[0] = p[k];
+          for (j = 1; j < n; ++j) q[j] = p[j * elem_size + k] - p[(j - 1) * elem_size + k];
+        } else if (filter & FASTLZ_FILTER_DELTA) {
+          const uint8_t* prev = p - elem_size;
+          for (j = 0; j < n; ++j) q[j] = p[j * elem_size + k] - prev[j * elem_size + k];
+        } else {
+          for (j = 0; j < n; ++j) q[j] = p[j * elem_size + k];
+        }
+      }
+    }
+  } else {
+    for (i = 0; i < elem_size && i < end; ++i) dest[i] = src[i];
+    for (i = elem_size; i < end; ++i) dest[i] = src[i] - src[i - elem_size];
+  }
+
+  for (i = end; i < length; ++i) dest[i] = src[i];
+}
+
+static void flz_unfilter(int filter, uint32_t elem_size, uint8_t* buffer, uint32_t length) {
+  uint32_t count = length / elem_size;
+  uint32_t end = count * elem_size;
+  uint32_t i;
+
+  if (filter & FASTLZ_FILTER_SHUFFLE) {
+    uint8_t chunk[FILTER_CHUNK];
+    uint32_t chunk_count = FILTER_CHUNK / elem_size;
+    uint32_t first, k, j;
+    for (first = 0; first < count; first += chunk_count) {
+      uint8_t* p = buffer + first * elem_size;
+      const uint8_t* q = chunk;
+      uint32_t n = (count - first < chunk_count) ? count - first : chunk_count;
+      fastlz_memcpy(chunk, p, n * elem_size);
+      for (k = 0; k < elem_size; ++k, q += n)
+        for (j = 0; j < n; ++j) p[j * elem_size + k] = q[j];
+    }
+  }
+
+  if (filter & FASTLZ_FILTER_DELTA) {
+    i = elem_size;
+#if defined(FLZ_ARCH64)
+    /* byte-wise addition of whole words, when they do not overlap */
+    if (elem_size >= 8) {
+      const uint64_t h = 0x8080808080808080ULL;
+      for (; i + 8 <= end; i += 8) {
+        uint64_t a = *(uint64_t*)(buffer + i);
+        uint64_t b = *(const uint64_t*)(buffer + i - elem_size);
+        *(uint64_t*)(buffer + i) = ((a & ~h) + (b & ~h)) ^ ((a ^ b) & h);
+      }
+    } else if (elem_size >= 4) {
+      const uint32_t h = 0x80808080UL;
+      for (; i + 4 <= end; i += 4) {
+        uint32_t a = *(uint32_t*)(buffer + i);
+        uint32_t b = *(const uint32_t*)(buffer + i - elem_size);
+        *(uint32_t*)(buffer + i) = ((a & ~h) + (b & ~h)) ^ ((a ^ b) & h);
+      }
+    }
+#endif
+    for (; i < end; ++i) buffer[i] += buffer[i - elem_size];
+  }
+}
+
+/* a regular block, i.e. produced by fastlz_compress_level */
+static int flz_decompress_block(const void* input, int length, void* output, int maxout) {
+  int level = ((*(const uint8_t*)input) >> 5) + 1;
+
+  if (level == 1) return fastlz1_decompress(input, length, output, maxout);
+  if (level == 2) return fastlz2_decompress(input, length, output, maxout);
+  if (level == 3) return fastlz3_decompress(input, length, output, maxout);
+  if (level == 4) return fastlz4_decompress(input, length, output, maxout);
+  if (level == 5) return fastlz5_decompress(input, length, output, maxout);
+  if (level == 6) return fastlz6_decompress(input, length, output, maxout);
+
+  return 0;
+}
+
+static int flz_decompress_filtered(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  int filter = ip[0] & 31;
+  uint32_t elem_size = ip[1];
+  int size;
+
+  if (length < 3 || elem_size == 0 || filter == 0 || (filter & ~FASTLZ_FILTER_ALL)) return 0;
+
+  size = flz_decompress_block(ip + 2, length - 2, output, maxout);
+  if (size > 0) flz_unfilter(filter, elem_size, (uint8_t*)output, size);
+  return size;
+}
+
+#define FRAME_TAG 6
+#define FRAME_BLOCK_SIZE 65536
+#define FRAME_HEADER 4
+
+/*
+  A frame is a sequence of regular blocks, every one of them preceded by
+  its size (4 bytes, least-significant byte first).
+*/
+static int flz_decompress_frame(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t* op_limit = op + maxout;
+
+  if ((*ip++ & 31) != 0) return 0;
+
+  while (ip < ip_limit) {
+    uint32_t size;
+    int count;
+    FASTLZ_BOUND_CHECK(FRAME_HEADER < ip_limit - ip);
+    size = flz_read32le(ip);
+    ip += FRAME_HEADER;
+    FASTLZ_BOUND_CHECK(size > 0 && size <= (uint32_t)(ip_limit - ip));
+    count = flz_decompress_block(ip, size, op, op_limit - op);
+    FASTLZ_BOUND_CHECK(count > 0);
+    ip += size;
+    op += count;
+  }
+
+  return op - (uint8_t*)output;
+}
+
+int fastlz_compress(const void* input, int length, void* output) {
+  /* for short block, choose fastlz1 */
+  if (length < 65536) return fastlz1_compress(input, length, output);
+
+  /* else... */
+  return fastlz2_compress(input, length, output);
+}
+
+int fastlz_decompress(const void* input, int length, void* output, int maxout) {
+  /* magic identifier for compression level */
+  int level = ((*(const uint8_t*)input) >> 5) + 1;
+
+  if (level == 1) return fastlz1_decompress(input, length, output, maxout);
+  if (level == 2) return fastlz2_decompress(input, length, output, maxout);
+  if (level == 3) return fastlz3_decompress(input, length, output, maxout);
+  if (level == 4) return fastlz4_decompress(input, length, output, maxout);
+  if (level == 5) return fastlz5_decompress(input, length, output, maxout);
+  if (level == 6) return fastlz6_decompress(input, length, output, maxout);
+  if (level == FILTERED_TAG + 1) return flz_decompress_filtered(input, length, output, maxout);
+  if (level == FRAME_TAG + 1) return flz_decompress_frame(input, length, output, maxout);
+
+  /* unknown level, trigger error */
+  return 0;
+}
+
+int fastlz_decompress_trusted(const void* input, int length, void* output, int outlen) {
+  /* magic identifier for compression level */
+  int level = ((*(const uint8_t*)input) >> 5) + 1;
+
+  if (outlen <= 0) return 0;
+
+  if (level == 1) return fastlz1_decompress_trusted(input, length, output, outlen);
+  if (level == 2) return fastlz2_decompress_trusted(input, length, output, outlen);
+  if (level == 3) return fastlz3_decompress_trusted(input, length, output, outlen);
+  if (level == 4) return fastlz4_decompress_trusted(input, length, output, outlen);
+  if (level == 5) return fastlz5_decompress_trusted(input, length, output, outlen);
+  if (level == 6) return fastlz6_decompress(input, length, output, outlen);
+  if (level == FRAME_TAG + 1) return flz_decompress_frame(input, length, output, outlen);
+
+  /* unknown level, trigger error */
+  return 0;
+}
+
+int fastlz_compress_level(int level, const void* input, int length, void* output) {
+  if (level == 1) return fastlz1_compress(input, length, output);
+  if (level == 2) return fastlz2_compress(input, length, output);
+  if (level == 3) return fastlz3_compress(input, length, output);
+  if (level == 4) return fastlz4_compress(input, length, output);
+  if (level == 5) return fastlz5_compress(input, length, output);
+  if (level == 6) return fastlz6_compress(input, length, output);
+
+  return 0;
+}
+
+int fastlz_compress_batch(int level, const void* const* inputs, const int* lengths, void* const* outputs,
+                          int* out_lengths, int n) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash, base;
+  int i;
+
+  if (level < 1 || level > 5 || level == 4) return 0;
+
+  /* initializes hash table, once for all blocks */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+  base = 0;
+
+  for (i = 0; i < n; ++i) {
+    /* start over before the positions overflow */
+    if (base > 0x7fffffffUL - lengths[i]) {
+      for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+      base = 0;
+    }
+
+    if (level == 1)
+      out_lengths[i] = flz1_compress(htab, base, 0, inputs[i], lengths[i], outputs[i], 0);
+    else if (level == 2)
+      out_lengths[i] = flz2_compress(htab, base, 0, inputs[i], lengths[i], outputs[i], 0);
+    else if (level == 3)
+      out_lengths[i] = flz3_compress(htab, base, inputs[i], lengths[i], outputs[i], 0);
+    else
+      out_lengths[i] = flz5_compress(htab, base, inputs[i], lengths[i], outputs[i], 0);
+
+    base += lengths[i] + MAX_FARDISTANCE;
+  }
+
+  return n;
+}
+
+int fastlz_decompress_batch(const void* const* inputs, const int* lengths, void* const* outputs, const int* maxouts,
+                            int* out_lengths, int n) {
+  int count = 0;
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    out_lengths[i] = fastlz_decompress(inputs[i], lengths[i], outputs[i], maxouts[i]);
+    if (out_lengths[i] > 0) ++count;
+  }
+
+  return count;
+}
+
+int fastlz_compressv(int level, const struct fastlz_iovec* iov, int iovcnt, void* output) {
+  if (level != 1 && level != 2) return 0;
+
+  /* nothing to stitch together */
+  if (iovcnt == 1) return fastlz_compress_level(level, iov[0].iov_base, iov[0].iov_len, output);
+
+  return flz_compressv(level, iov, iovcnt, output);
+}
+
+int fastlz_decompress_pages(const void* input, int length, void* const* pages, int page_size, int npages) {
+  /* magic identifier for compression level */
+  int level = ((*(const uint8_t*)input) >> 5) + 1;
+  uint32_t shift = 0;
+
+  /* only power-of-two page size */
+  if (page_size <= 0 || (page_size & (page_size - 1)) != 0) return 0;
+  while ((1 << shift) < page_size) ++shift;
+  if (npages <= 0 || npages > 0x7fffffff / page_size) return 0;
+
+  if (level == 1) return flz_decompress_pages(1, input, length, (uint8_t* const*)pages, shift, npages);
+  if (level == 2) return flz_decompress_pages(2, input, length, (uint8_t* const*)pages, shift, npages);
+  if (level == 3) return flz_decompress_pages(3, input, length, (uint8_t* const*)pages, shift, npages);
+
+  /* unknown level, trigger error */
+  return 0;
+}
+
+int fastlz_page_filled(const void* page) { return flz_page_filled((const uint8_t*)page); }
+
+int fastlz_compress_page(const void* page, void* output) {
+  return flz_compress_page((const uint8_t*)page, (uint8_t*)output);
+}
+
+int fastlz_decompress_page(const void* input, int length, void* page) {
+  /* magic identifier for compression level */
+  int level = ((*(const uint8_t*)input) >> 5) + 1;
+  int size;
+
+  if (level == 2)
+    size = fastlz2_decompress(input, length, page, FASTLZ_PAGE_SIZE);
+  else
+    size = fastlz_decompress(input, length, page, FASTLZ_PAGE_SIZE);
+
+  return (size == FASTLZ_PAGE_SIZE) ? size : 0;
+}
+
+int fastlz_estimate_ratio(const void* input, int length) {
+  if (length <= 0) return 0;
+  return flz_estimate((const uint8_t*)input, length);
+}
+
+int fastlz_compress_adaptive(const void* input, int length, void* output) {
+  int ratio = fastlz_estimate_ratio(input, length);
+  uint8_t* op = (uint8_t*)output;
+
+  /* hardly compressible: store as a single level 5 literal run, skip the match search */
+  if (ratio >= ADAPTIVE_STORE_RATIO) {
+    int size = flz5_literals(length, (const uint8_t*)input, op) - op;
+    *op |= (4 << 5);
+    return size;
+  }
+
+  /* level 2 pays off beyond the level 1 window or for long matches */
+  if (ratio <= ADAPTIVE_LEVEL2_RATIO || length > MAX_L1_DISTANCE) return fastlz2_compress(input, length, output);
+
+  return fastlz1_compress(input, length, output);
+}
+
+int fastlz_compress_fastdecode(int level, const void* input, int length, void* output) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash;
+
+  if (level != 1 && level != 2) return 0;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  if (level == 1) return flz1_compress(htab, 0, FASTDECODE_MIN_MATCH, input, length, output, 0);
+  return flz2_compress(htab, 0, FASTDECODE_MIN_MATCH, input, length, output, 0);
+}
+
+int fastlz_compress_filtered(int level, int filter, int elem_size, const void* input, int length, void* output,
+                             void* scratch) {
+  uint8_t* op = (uint8_t*)output;
+  int size;
+
+  if (filter == 0) return fastlz_compress_level(level, input, length, output);
+  if (filter & ~FASTLZ_FILTER_ALL) return 0;
+  if (elem_size < 1 || elem_size > 255) return 0;
+  if (level < 1 || level > 6) return 0;
+
+  flz_filter(filter, elem_size, (const uint8_t*)input, (uint8_t*)scratch, length);
+  size = fastlz_compress_level(level, scratch, length, op + 2);
+
+  op[0] = (FILTERED_TAG << 5) | filter;
+  op[1] = elem_size;
+  return size + 2;
+}
+
+int fastlz_compress_budget(const void* input, int length, void* output, unsigned long budget, fastlz_clock clock,
+                           void* context) {
+  const uint8_t* ip = (const uint8_t*)input;
+  uint8_t* op = (uint8_t*)output;
+  uint32_t htab[HASH_SIZE];
+  uint32_t hash, base;
+  unsigned long start = clock(context);
+  double slice = (double)budget * FRAME_BLOCK_SIZE / length;
+  int level = 2;
+  int pos;
+
+  /* initializes hash table, once for all blocks */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+  base = 0;
+
+  *op++ = FRAME_TAG << 5;
+  for (pos = 0; pos < length; pos += FRAME_BLOCK_SIZE) {
+    int size = (length - pos < FRAME_BLOCK_SIZE) ? length - pos : FRAME_BLOCK_SIZE;
+    uint8_t* block = op + FRAME_HEADER;
+    int count = size;
+
+    /* one level down when behind the schedule, one level up when well ahead */
+    if (pos > 0) {
+      double elapsed = clock(context) - start;
+      double allowed = (double)budget * pos / length;
+      if (elapsed > allowed && level > 0)
+        --level;
+      else if (elapsed + slice < allowed && level < 2)
+        ++level;
+    }
+
+    /* start over before the positions overflow */
+    if (base > 0x7fffffffUL - size) {
+      for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+      base = 0;
+    }
+
+    if (level == 2)
+      count = flz2_compress(htab, base, 0, ip + pos, size, block, 0);
+    else if (level == 1)
+      count = flz1_compress(htab, base, 0, ip + pos, size, block, 0);
+    base += size + MAX_FARDISTANCE;
+
+    /* stored as a single level 5 literal run */
+    if (count >= size) {
+      count = flz5_literals(size, ip + pos, block) - block;
+      *block |= (4 << 5);
+    }
+
+    flz_write32le(op, count);
+    op = block + count;
+  }
+
+  return op - (uint8_t*)output;
+}
+
+size_t fastlz_compress_memory(int level) {
+  if (level < 1 || level > 6) return 0;
+  if (level == 4) return (HASH_SIZE + LR_HASH_SIZE) * sizeof(uint32_t);
+  return HASH_SIZE * sizeof(uint32_t);
+}
+
+int fastlz_compress_alloc(int level, const void* input, int length, void* output,
+                          const struct fastlz_allocator* allocator) {
+  size_t size = fastlz_compress_memory(level);
+  uint32_t* htab;
+  uint32_t hash;
+  int result = 0;
+
+  if (size == 0) return 0;
+  htab = (uint32_t*)allocator->alloc(allocator->opaque, size);
+  if (!htab) return 0;
+
+  /* initializes hash table, level 4 clears its long-range table itself */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  if (level == 1) result = flz1_compress(htab, 0, 0, input, length, output, 0);
+  if (level == 2) result = flz2_compress(htab, 0, 0, input, length, output, 0);
+  if (level == 3) result = flz3_compress(htab, 0, input, length, output, 0);
+  if (level == 4) result = flz4_compress(htab, htab + HASH_SIZE, 0, input, length, output, 0);
+  if (level == 5) result = flz5_compress(htab, 0, input, length, output, 0);
+  if (level == 6) {
+    if (length < MIN_L6_LENGTH)
+      result = flz2_compress(htab, 0, 0, input, length, output, 0);
+    else
+      result = flz6_compress(htab, input, length, output, 0);
+  }
+
+  allocator->free(allocator->opaque, htab);
+  return result;
+}
+
+/*
+  The streaming decoder runs the opcodes of level 1 to 5 one byte at a
+  time, hence it can stop anywhere in the input and resume with the next
+  fragment. Literal runs are copied straight from the fragments.
+*/
+#define FLZ_STREAM_TAG 0
+#define FLZ_STREAM_OPCODE 1
+#define FLZ_STREAM_LENGTH 2
+#define FLZ_STREAM_DISTANCE 3
+#define FLZ_STREAM_LITERAL 4
+#define FLZ_STREAM_ERROR 5
+
+void fastlz_decoder_init(struct fastlz_decoder* decoder, void* output, int maxout) {
+  memset(decoder, 0, sizeof(struct fastlz_decoder));
+  decoder->output = (unsigned char*)output;
+  decoder->maxout = (maxout > 0) ? maxout : 0;
+  decoder->state = FLZ_STREAM_TAG;
+}
+
+int fastlz_decoder_feed(struct fastlz_decoder* decoder, const void* input, int length) {
+  const uint8_t* ip = (const uint8_t*)input;
+  const uint8_t* ip_limit = ip + ((length > 0) ? length : 0);
+  uint8_t* output = decoder->output;
+  uint32_t maxout = decoder->maxout;
+  uint32_t pos = decoder->pos;
+  uint32_t len = decoder->len;
+  uint32_t ofs = decoder->ofs;
+  uint32_t run = decoder->run;
+  uint32_t ctrl = decoder->ctrl;
+  uint32_t need = decoder->need;
+  uint32_t got = decoder->got;
+  int level = decoder->level;
+  int state = decoder->state;
+
+  while (ip < ip_limit && state != FLZ_STREAM_ERROR) {
+    uint32_t code = *ip;
+
+    if (state == FLZ_STREAM_LITERAL) {
+      uint32_t count = (run < (uint32_t)(ip_limit - ip)) ? run : (uint32_t)(ip_limit - ip);
+      if (run > maxout - pos) {
+        state = FLZ_STREAM_ERROR;
+        break;
+      }
+      fastlz_memcpy(output + pos, ip, count);
+      ip += count;
+      pos += count;
+      run -= count;
+      if (run == 0) state = FLZ_STREAM_OPCODE;
+      continue;
+    }
+    ++ip;
+
+    if (state == FLZ_STREAM_TAG || state == FLZ_STREAM_OPCODE) {
+      if (state == FLZ_STREAM_TAG) {
+        /* magic identifier for compression level */
+        level = (code >> 5) + 1;
+        if (level > 5) {
+          state = FLZ_STREAM_ERROR;
+          break;
+        }
+        code &= 31;
+      }
+      ctrl = code;
+      if (ctrl < 32) {
+        run = ctrl + 1;
+        state = (level == 5 && ctrl == 31) ? FLZ_STREAM_LENGTH : FLZ_STREAM_LITERAL;
+        continue;
+      }
+      len = (ctrl >> 5) - 1;
+      if (len == 7 - 1) {
+        state = FLZ_STREAM_LENGTH;
+        continue;
+      }
+    } else if (state == FLZ_STREAM_LENGTH) {
+      /* 255 continues the length in level 2 and level 4 matches, and level 5 literal runs */
+      if (ctrl < 32) {
+        run += code;
+        if (code < 255) state = FLZ_STREAM_LITERAL;
+        continue;
+      }
+      len += code;
+      if (code == 255 && (level == 2 || level == 4)) continue;
+    } else {
+      /* level 2 escapes a 16-bit distance, other levels are little endian */
+      if (level == 2 && got > 0)
+        ofs += code << (8 * (2 - got));
+      else if (level == 2 && code == 255 && ofs == (31 << 8)) {
+        ofs = MAX_L2_DISTANCE;
+        need = 3;
+      } else
+        ofs += code << (8 * got);
+      if (++got < need) continue;
+
+      len += 3;
+      if (ofs >= pos || len > maxout - pos) {
+        state = FLZ_STREAM_ERROR;
+        break;
+      }
+      fastlz_memmove(output + pos, output + pos - ofs - 1, len);
+      pos += len;
+      state = FLZ_STREAM_OPCODE;
+      continue;
+    }
+
+    /* the length of the match is complete, the distance follows */
+    {
+      uint32_t far = (ctrl >> 4) & 1;
+      got = 0;
+      need = 1;
+      ofs = (ctrl & 31) << 8;
+      if (level >= 3) {
+        need = 1 + far;
+        ofs = (ctrl & 15) << 8;
+      }
+      if (level == 4 && far) {
+        need += (ctrl >> 3) & 1;
+        ofs = 0;
+      }
+      state = FLZ_STREAM_DISTANCE;
+    }
+  }
+
+  decoder->pos = pos;
+  decoder->len = len;
+  decoder->ofs = ofs;
+  decoder->run = run;
+  decoder->ctrl = ctrl;
+  decoder->need = need;
+  decoder->got = got;
+  decoder->level = level;
+  decoder->state = state;
+
+  return (state == FLZ_STREAM_ERROR) ? -1 : (int)pos;
+}
+
+int fastlz_decoder_finish(struct fastlz_decoder* decoder) {
+  /* the block must end between two opcodes */
+  if (decoder->state != FLZ_STREAM_OPCODE) return 0;
+  return decoder->pos;
+}
+
+#if defined(FASTLZ_STATS)
+
+int fastlz_compress_ex(int level, const void* input, int length, void* output, struct fastlz_stats* stats) {
+  uint32_t htab[HASH_SIZE];
+  uint32_t ltab[LR_HASH_SIZE];
+  uint32_t hash;
+
+  /* initializes hash table */
+  for (hash = 0; hash < HASH_SIZE; ++hash) htab[hash] = 0;
+
+  if (level == 1) return flz1_compress(htab, 0, 0, input, length, output, stats);
+  if (level == 2) return flz2_compress(htab, 0, 0, input, length, output, stats);
+  if (level == 3) return flz3_compress(htab, 0, input, length, output, stats);
+  if (level == 4) return flz4_compress(htab, ltab, 0, input, length, output, stats);
+  if (level == 5) return flz5_compress(htab, 0, input, length, output, stats);
+  if (level == 6) {
+    if (length < MIN_L6_LENGTH) return flz2_compress(htab, 0, 0, input, length, output, stats);
+    return flz6_compress(htab, input, length, output, stats);
+  }
+
+  return 0;
+}
+
+#endif /* FASTLZ_STATS */
+
 #pragma GCC diagnostic pop
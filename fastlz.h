@@ -32,6 +32,8 @@
 
 #define FASTLZ_VERSION_STRING "0.5.0"
 
+#include <stddef.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -50,9 +52,19 @@ extern "C" {
   The input buffer and the output buffer can not overlap.
 
   Compression level can be specified in parameter level. At the moment,
-  only level 1 and level 2 are supported.
+  only level 1 to level 6 are supported.
   Level 1 is the fastest compression and generally useful for short data.
   Level 2 is slightly slower but it gives better compression ratio.
+  Level 3 is a variant of level 1 with a 64 KB window, hence giving better
+  compression ratio on larger blocks, typically close to level 2.
+  Level 4 extends level 3 with matches up to 16 MB away, for large blocks
+  with repeats at long distance (e.g. disk images). It needs about 96 KB
+  of stack.
+  Level 5 is level 3 with a compact encoding of long literal runs, which
+  suits poorly compressible data (e.g. mixed media payloads).
+  Level 6 is level 2 with Huffman-coded literals, giving a slightly better
+  compression ratio at the cost of speed. Blocks shorter than 1 KB are
+  compressed with level 2 instead.
 
   Note that the compressed data, regardless of the level, can always be
   decompressed using the function fastlz_decompress below.
@@ -69,7 +81,9 @@ int fastlz_compress_level(int level, const void* input, int length, void* output
   The input buffer and the output buffer can not overlap.
 
   Decompression is memory safe and guaranteed not to write the output buffer
-  more than what is specified in maxout.
+  more than what is specified in maxout. However, the part of the output
+  buffer past the decompressed data (up to maxout) may be overwritten, since
+  short copies are carried out 32 bytes at a time where there is room.
 
   Note that the decompression will always work, regardless of the
   compression level specified in fastlz_compress_level above (when
@@ -78,6 +92,357 @@ int fastlz_compress_level(int level, const void* input, int length, void* output
 
 int fastlz_decompress(const void* input, int length, void* output, int maxout);
 
+/**
+  Decompress a block of compressed data from a trusted source and returns
+  the size of the decompressed block.
+
+  Unlike fastlz_decompress, there is no bound check whatsoever: the
+  compressed block must be exactly what fastlz_compress_level produced
+  (e.g. it has been verified by a checksum) and outlen must be exactly
+  the size of the original uncompressed block. Passing a corrupted block
+  or a wrong outlen results in undefined behavior.
+
+  The input buffer and the output buffer can not overlap.
+
+  When in doubt, use fastlz_decompress instead.
+*/
+
+int fastlz_decompress_trusted(const void* input, int length, void* output, int outlen);
+
+/**
+  Compress n independent blocks of data in one call. The i-th block,
+  inputs[i] with the size of lengths[i], is compressed into outputs[i] and
+  the size of the compressed block is stored in out_lengths[i].
+
+  Every compressed block is exactly what fastlz_compress_level would have
+  produced, the same buffer requirements apply to each of them, and each
+  one can be decompressed on its own. This is useful to compress many short
+  messages, since the per-call setup (e.g. initializing the hash table) is
+  carried out only once for the whole batch.
+
+  Returns n, or 0 if the compression level is not supported.
+*/
+
+int fastlz_compress_batch(int level, const void* const* inputs, const int* lengths, void* const* outputs,
+                          int* out_lengths, int n);
+
+/**
+  Decompress n independent blocks of compressed data in one call. The i-th
+  block, inputs[i] with the size of lengths[i], is decompressed into
+  outputs[i] which can hold at most maxouts[i] bytes. The size of the
+  decompressed block is stored in out_lengths[i], or 0 if that block can
+  not be decompressed (see fastlz_decompress).
+
+  Returns the number of blocks successfully decompressed.
+*/
+
+int fastlz_decompress_batch(const void* const* inputs, const int* lengths, void* const* outputs, const int* maxouts,
+                            int* out_lengths, int n);
+
+/**
+  One segment of the input for fastlz_compressv below. The layout is the
+  same as struct iovec on POSIX systems, therefore an array of struct iovec
+  can be passed as is (after a cast).
+*/
+
+struct fastlz_iovec {
+  const void* iov_base;
+  size_t iov_len;
+};
+
+/**
+  Compress the concatenation of iovcnt segments of data and returns the
+  size of compressed block, without the need to concatenate the segments
+  first. A match can refer to the data in any of the previous segments.
+
+  The compressed block is a regular one, i.e. it can be decompressed using
+  fastlz_decompress, and the same rules as in fastlz_compress_level apply,
+  with the length being the total size of all segments. Additionally, the
+  output buffer needs one extra byte for every segment.
+
+  Only compression level 1 and level 2 are supported.
+*/
+
+int fastlz_compressv(int level, const struct fastlz_iovec* iov, int iovcnt, void* output);
+
+/**
+  Decompress a block of compressed data into a list of fixed-size pages,
+  instead of one contiguous output buffer, and returns the size of the
+  decompressed block. The decompressed data fills pages[0] first, then
+  pages[1], and so on. The size of every page, page_size, must be a power
+  of two (e.g. 4096), and there are npages of them.
+
+  As with fastlz_decompress, 0 (zero) is returned if the compressed data is
+  corrupted or the pages can not hold the decompressed data.
+*/
+
+int fastlz_decompress_pages(const void* input, int length, void* const* pages, int page_size, int npages);
+
+#define FASTLZ_PAGE_SIZE 4096
+#define FASTLZ_PAGE_BOUND (FASTLZ_PAGE_SIZE + FASTLZ_PAGE_SIZE / 32)
+
+/**
+  Check whether a page of FASTLZ_PAGE_SIZE bytes is filled with the same
+  8-byte pattern (its first 8 bytes), e.g. a page of zeros. Returns 1 if
+  this is the case, 0 otherwise.
+*/
+
+int fastlz_page_filled(const void* page);
+
+/**
+  Compress a page of FASTLZ_PAGE_SIZE bytes and returns the size of
+  compressed block. This is a variant of fastlz_compress_level with level
+  2, specialized for the page size (e.g. with a smaller hash table), for
+  the lowest latency per page. A page filled with the same 8-byte pattern
+  (see fastlz_page_filled) is compressed without searching for matches.
+
+  The output buffer must be at least FASTLZ_PAGE_BOUND bytes.
+*/
+
+int fastlz_compress_page(const void* page, void* output);
+
+/**
+  Decompress a page compressed by fastlz_compress_page (or any compressed
+  block of exactly FASTLZ_PAGE_SIZE bytes) and returns FASTLZ_PAGE_SIZE.
+  If the compressed data is corrupted or does not decompress to exactly
+  one page, 0 (zero) is returned instead.
+*/
+
+int fastlz_decompress_page(const void* input, int length, void* page);
+
+/**
+  Estimate how well a block of data compresses, by sampling a few parts of
+  the input, and returns the estimated size of the compressed block as a
+  percentage of length (e.g. 40 means 60% smaller). Data which can not be
+  compressed gives an estimate of about 100 or more.
+
+  The estimate is cheap to compute (at most a few kilobytes are examined)
+  and is thus only a rough guide.
+*/
+
+int fastlz_estimate_ratio(const void* input, int length);
+
+/**
+  Compress a block of data like fastlz_compress_level, but with the level
+  automatically chosen based on fastlz_estimate_ratio: level 2 for highly
+  compressible or large data, level 1 otherwise. Data which hardly
+  compresses is stored as a single level 5 literal run without searching
+  for matches.
+
+  The same buffer requirements as in fastlz_compress_level apply, and the
+  compressed block can be decompressed using fastlz_decompress.
+*/
+
+int fastlz_compress_adaptive(const void* input, int length, void* output);
+
+/**
+  Compress a block of data like fastlz_compress_level, but favor the
+  decompression speed over the compression ratio: a short match which
+  interrupts a literal run is not used, since the extra instructions to
+  decode outweigh the byte or two it saves. Typically the compressed block
+  is a few percent larger, but it decompresses 10-30% faster. This is
+  useful for data which is compressed once and decompressed many times.
+
+  The same buffer requirements as in fastlz_compress_level apply, and the
+  compressed block can be decompressed using fastlz_decompress.
+
+  Only compression level 1 and level 2 are supported; for other levels,
+  0 (zero) is returned.
+*/
+
+int fastlz_compress_fastdecode(int level, const void* input, int length, void* output);
+
+#define FASTLZ_FILTER_SHUFFLE 1
+#define FASTLZ_FILTER_DELTA 2
+#define FASTLZ_FILTER_ALL (FASTLZ_FILTER_SHUFFLE | FASTLZ_FILTER_DELTA)
+
+/**
+  Compress an array of fixed-size elements (e.g. int32, int64, or float
+  values) after applying a filter which makes it more compressible, and
+  returns the size of compressed block.
+
+  The filter is FASTLZ_FILTER_SHUFFLE, FASTLZ_FILTER_DELTA, or both:
+  shuffle groups the bytes of the elements by their position (all first
+  bytes, then all second bytes, etc.), while delta stores every byte as
+  the difference to the same byte of the previous element. The size of
+  every element, elem_size, is between 1 and 255. If length is not a
+  multiple of elem_size, the trailing bytes are stored as they are.
+
+  The filtered data is prepared in scratch, which must be at least length
+  bytes. The output buffer needs 2 bytes more than for fastlz_compress_level
+  (the filter is recorded in the block), and level 1 to level 6 are
+  supported.
+
+  The compressed block is decompressed, and the filter undone, by
+  fastlz_decompress.
+*/
+
+int fastlz_compress_filtered(int level, int filter, int elem_size, const void* input, int length, void* output,
+                             void* scratch);
+
+/**
+  A clock for fastlz_compress_budget below, returning the current time in
+  any unit (e.g. microseconds, or CPU cycles). The context is passed as is.
+*/
+
+typedef unsigned long (*fastlz_clock)(void* context);
+
+/**
+  Compress a block of data within a time budget, and returns the size of
+  the compressed frame. The input is split into blocks of 64 KB. Every
+  block is compressed with level 2, but whenever the compression falls
+  behind the schedule (the time spent so far, according to clock, exceeds
+  the share of budget for the data compressed so far), the next blocks
+  are compressed with level 1 instead, and then only stored. When the
+  compression is well ahead again, the level goes back up.
+
+  The output buffer needs 5 bytes more for every block of 64 KB (or part
+  of it) than what fastlz_compress_level requires.
+
+  The compressed frame can be decompressed using fastlz_decompress.
+*/
+
+int fastlz_compress_budget(const void* input, int length, void* output, unsigned long budget, fastlz_clock clock,
+                           void* context);
+
+/**
+  Memory allocator for the functions taking one. alloc returns a block of
+  at least size bytes, suitably aligned for any type, or NULL on failure.
+  free releases a block returned by alloc. Both receive opaque as their
+  first argument, e.g. to select an arena or a NUMA node.
+
+  Without an allocator, FastLZ never allocates from the heap: the working
+  memory of every function lives on the stack.
+*/
+
+struct fastlz_allocator {
+  void* (*alloc)(void* opaque, size_t size);
+  void (*free)(void* opaque, void* ptr);
+  void* opaque;
+};
+
+/**
+  Returns the exact size, in bytes, of the working memory which
+  fastlz_compress_alloc below requests for the given compression level:
+  32 KB for level 1 to 6 except level 4, which needs 96 KB. For an
+  unsupported level, 0 is returned.
+*/
+
+size_t fastlz_compress_memory(int level);
+
+/**
+  Compress a block of data exactly like fastlz_compress_level, but with the
+  working memory (the hash tables, which otherwise live on the stack)
+  obtained from the allocator. Every call allocates one block of
+  fastlz_compress_memory(level) bytes and frees it before returning, hence
+  a pool of blocks of that size is enough to serve all the calls.
+
+  If the allocation fails, 0 is returned.
+*/
+
+int fastlz_compress_alloc(int level, const void* input, int length, void* output,
+                          const struct fastlz_allocator* allocator);
+
+/**
+  State of a streaming decoder, see fastlz_decoder_init below. The fields
+  are private; the state is plain data, so it can live anywhere (e.g. next
+  to a connection) without any allocation.
+*/
+
+struct fastlz_decoder {
+  unsigned char* output;
+  unsigned long maxout;
+  unsigned long pos;
+  unsigned long len;
+  unsigned long ofs;
+  unsigned long run;
+  unsigned int ctrl;
+  unsigned int need;
+  unsigned int got;
+  int level;
+  int state;
+};
+
+/**
+  Prepare a streaming decoder, for a block which decompresses into the
+  output buffer of maxout bytes.
+
+  A streaming decoder takes the compressed block in fragments of any size,
+  as they arrive (e.g. from a socket), with fastlz_decoder_feed, and can
+  stop in the middle of an opcode until the next fragment. The output is
+  produced incrementally, so that the beginning of the block can be used
+  before the rest has arrived. Only level 1 to level 5 blocks are
+  supported.
+*/
+
+void fastlz_decoder_init(struct fastlz_decoder* decoder, void* output, int maxout);
+
+/**
+  Decode the next fragment of the compressed block, of the given length.
+  Every byte of the fragment is consumed; it does not need to be kept
+  afterwards.
+
+  Returns the number of bytes in the output buffer decompressed so far
+  (they are final), or -1 if the block is corrupted, not supported, or
+  expands beyond maxout. After an error, the decoder stays in error.
+*/
+
+int fastlz_decoder_feed(struct fastlz_decoder* decoder, const void* input, int length);
+
+/**
+  Complete the decoding, once the last fragment has been fed. Returns the
+  size of the decompressed block, or 0 if an error occurred or the block
+  is truncated.
+*/
+
+int fastlz_decoder_finish(struct fastlz_decoder* decoder);
+
+#if defined(FASTLZ_STATS)
+
+#define FASTLZ_STATS_LENGTHS 32
+
+/**
+  Statistics gathered by fastlz_compress_ex below.
+
+  Every probe of the hash table for a match candidate is either a hit (the
+  match is taken), a miss (the entry is empty or too far away), or a
+  collision (the entry is within reach but the bytes differ). Within a
+  match, only the first and the last two positions are inserted into the
+  hash table; the rest are counted as skipped.
+
+  match_lengths[i] is the number of matches whose length is in the range
+  of 2^i to 2^(i+1)-1 bytes. Far matches (with 16-bit distance) exist only
+  in level 2 to level 4.
+*/
+
+struct fastlz_stats {
+  unsigned long literal_bytes;
+  unsigned long literal_runs;
+  unsigned long matches;
+  unsigned long match_bytes;
+  unsigned long match_lengths[FASTLZ_STATS_LENGTHS];
+  unsigned long near_matches;
+  unsigned long far_matches;
+  unsigned long hash_hits;
+  unsigned long hash_misses;
+  unsigned long hash_collisions;
+  unsigned long bytes_skipped;
+};
+
+/**
+  Compress a block of data exactly like fastlz_compress_level, and add the
+  statistics of the compression to stats. The counters are never reset,
+  so that the totals of many blocks can be collected (clear stats before
+  the first call).
+
+  This function is available only if the library is compiled with
+  FASTLZ_STATS defined; otherwise, no instrumentation is compiled in.
+*/
+
+int fastlz_compress_ex(int level, const void* input, int length, void* output, struct fastlz_stats* stats);
+
+#endif /* FASTLZ_STATS */
+
 /**
   DEPRECATED.
 
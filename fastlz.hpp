@@ -0,0 +1,248 @@
+/*
+  FastLZ - Byte-aligned LZ77 compression library
+  Copyright (C) 2005-2020 Ariya Hidayat <ariya.hidayat@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#ifndef FASTLZ_HPP
+#define FASTLZ_HPP
+
+/*
+  Header-only C++17 wrapper for the API in fastlz.h. The compression itself
+  still lives in fastlz.c, which must be compiled and linked as usual.
+*/
+
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define FASTLZ_HPP_PMR 1
+#endif
+#endif
+
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#include <span>
+#endif
+
+#include "fastlz.h"
+
+namespace fastlz {
+
+/**
+  A read-only view of a block of bytes. It does not own the memory and is
+  implicitly constructible from std::string_view, std::span (C++20) and
+  any contiguous container (std::string, std::vector, etc.), so that all
+  of them can be passed to the functions below without a copy.
+*/
+
+class bytes {
+ public:
+  bytes() noexcept : data_(nullptr), size_(0) {}
+  bytes(const void* data, std::size_t size) noexcept : data_(static_cast<const unsigned char*>(data)), size_(size) {}
+  bytes(std::string_view s) noexcept : bytes(s.data(), s.size()) {}
+
+  template <class C, class T = decltype(*std::declval<const C&>().data()),
+            class = decltype(std::declval<const C&>().size())>
+  bytes(const C& c) noexcept : bytes(c.data(), c.size() * sizeof(T)) {}
+
+  const unsigned char* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  const unsigned char* begin() const noexcept { return data_; }
+  const unsigned char* end() const noexcept { return data_ + size_; }
+  std::string_view view() const noexcept { return {reinterpret_cast<const char*>(data_), size_}; }
+
+#if defined(__cpp_lib_span)
+  operator std::span<const unsigned char>() const noexcept { return {data_, size_}; }
+#endif
+
+ private:
+  const unsigned char* data_;
+  std::size_t size_;
+};
+
+/**
+  Returns the output buffer size which is large enough to compress a block
+  of the given length, i.e. at least 5% larger and not smaller than 66 bytes.
+*/
+
+constexpr std::size_t compress_bound(std::size_t length) noexcept {
+  return length + length / 20 + 1 < 66 ? 66 : length + length / 20 + 1;
+}
+
+namespace detail {
+
+inline bool compress(int level, bytes input, void* output, int& result) noexcept {
+  result = 0;
+  if (input.empty()) return true;
+  if (input.size() > INT_MAX) return false;
+  result = fastlz_compress_level(level, input.data(), static_cast<int>(input.size()), output);
+  return result > 0;
+}
+
+inline bool decompress(bytes input, void* output, std::size_t maxout, int& result) noexcept {
+  result = 0;
+  if (input.empty()) return true;
+  if (input.size() > INT_MAX) return false;
+  if (maxout > INT_MAX) maxout = INT_MAX;
+  result = fastlz_decompress(input.data(), static_cast<int>(input.size()), output, static_cast<int>(maxout));
+  return result > 0;
+}
+
+}  // namespace detail
+
+/**
+  Compress the input into an existing output buffer, which can be any
+  resizable contiguous container of bytes (std::string, std::vector of
+  char, unsigned char or std::byte, and their std::pmr counterparts).
+  The previous content of the output is replaced; its capacity is reused,
+  so that no allocation happens once it has grown large enough.
+
+  Returns true on success, with the compressed block in the output. An
+  empty input gives an empty output. On error (e.g. an unsupported level),
+  false is returned and the output is left empty.
+*/
+
+template <class Buffer>
+bool compress(bytes input, Buffer& output, int level = 1) {
+  int size;
+  output.resize(compress_bound(input.size()));
+  bool ok = detail::compress(level, input, output.data(), size);
+  output.resize(static_cast<std::size_t>(size));
+  return ok;
+}
+
+/**
+  Decompress the input into an existing output buffer (see compress above
+  for the supported types), reusing its capacity. The decompressed block
+  can not be larger than maxout bytes.
+
+  Returns true on success, with the decompressed block in the output. On
+  error (e.g. corrupted data, or maxout is too small), false is returned
+  and the output is left empty.
+*/
+
+template <class Buffer>
+bool decompress(bytes input, Buffer& output, std::size_t maxout) {
+  int size;
+  output.resize(maxout);
+  bool ok = detail::decompress(input, output.data(), maxout, size);
+  output.resize(static_cast<std::size_t>(size));
+  return ok;
+}
+
+/**
+  A compression context: it owns an output buffer obtained from the given
+  allocator (e.g. an arena via std::pmr::polymorphic_allocator) and keeps
+  it for the following calls. The buffer only ever grows, hence after the
+  first few blocks compressing does not allocate nor clear any memory. It
+  is released when the context goes out of scope.
+
+  The view returned by compress stays valid until the next call or until
+  the context is destroyed. A context is not thread-safe; use one per
+  thread.
+*/
+
+template <class Allocator = std::allocator<unsigned char>>
+class basic_compressor {
+ public:
+  using allocator_type = Allocator;
+
+  explicit basic_compressor(int level = 1, const Allocator& alloc = Allocator()) : level_(level), buffer_(alloc) {}
+
+  int level() const noexcept { return level_; }
+  void set_level(int level) noexcept { level_ = level; }
+  allocator_type get_allocator() const { return buffer_.get_allocator(); }
+
+  /**
+    Compress the input and returns the compressed block. An empty view is
+    returned on error, or when the input is empty.
+  */
+  bytes compress(bytes input) {
+    int size;
+    std::size_t bound = compress_bound(input.size());
+    if (buffer_.size() < bound) buffer_.resize(bound);
+    if (!detail::compress(level_, input, buffer_.data(), size)) size = 0;
+    return bytes(buffer_.data(), static_cast<std::size_t>(size));
+  }
+
+ private:
+  int level_;
+  std::vector<unsigned char, Allocator> buffer_;
+};
+
+/**
+  A decompression context, the counterpart of basic_compressor: the
+  output buffer is owned by the context, grows up to the largest maxout
+  so far, and is reused for the following calls.
+*/
+
+template <class Allocator = std::allocator<unsigned char>>
+class basic_decompressor {
+ public:
+  using allocator_type = Allocator;
+
+  explicit basic_decompressor(const Allocator& alloc = Allocator()) : buffer_(alloc) {}
+
+  allocator_type get_allocator() const { return buffer_.get_allocator(); }
+
+  /**
+    Decompress the input, which can not expand to more than maxout bytes,
+    and returns the decompressed block. An empty view is returned on error,
+    or when the input is empty.
+  */
+  bytes decompress(bytes input, std::size_t maxout) {
+    int size;
+    if (buffer_.size() < maxout) buffer_.resize(maxout);
+    if (!detail::decompress(input, buffer_.data(), maxout, size)) size = 0;
+    return bytes(buffer_.data(), static_cast<std::size_t>(size));
+  }
+
+ private:
+  std::vector<unsigned char, Allocator> buffer_;
+};
+
+using compressor = basic_compressor<>;
+using decompressor = basic_decompressor<>;
+
+#if defined(FASTLZ_HPP_PMR)
+namespace pmr {
+
+/**
+  Allocator-aware variants, for buffers owned by a std::pmr::memory_resource
+  (e.g. std::pmr::monotonic_buffer_resource over an arena).
+*/
+
+using buffer = std::pmr::vector<unsigned char>;
+using compressor = basic_compressor<std::pmr::polymorphic_allocator<unsigned char>>;
+using decompressor = basic_decompressor<std::pmr::polymorphic_allocator<unsigned char>>;
+
+}  // namespace pmr
+#endif
+
+}  // namespace fastlz
+
+#endif /* FASTLZ_HPP */
@@ -0,0 +1,569 @@
+/*
+  FastLZ - Byte-aligned LZ77 compression library
+  Copyright (C) 2005-2020 Ariya Hidayat <ariya.hidayat@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#define _POSIX_C_SOURCE 199309L
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCHMARK_PERF_EVENTS
+#endif
+
+#include "fastlz.h"
+
+#define MAX_FILE_SIZE (100 * 1024 * 1024)
+#define MAX_REPEATS 100
+#define MAX_BASELINE 256
+#define CHECK_RETRIES 2
+
+enum { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSON };
+
+/* hardware counters, see -p */
+enum { COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_BRANCH_MISSES, COUNTER_L1_MISSES, COUNTER_LLC_MISSES, COUNTERS };
+
+/* reported from the counters: cycles/byte, IPC, and misses per KB */
+static const char* metric_names[COUNTERS] = {"cycles_per_byte", "ipc", "branch_misses_per_kb", "l1_misses_per_kb",
+                                             "llc_misses_per_kb"};
+
+/* file descriptor of every counter, or -1 if not available */
+static int counter_fds[COUNTERS] = {-1, -1, -1, -1, -1};
+
+typedef struct {
+  const char* name;
+  int level;
+  long size;
+  long compressed_size;
+  double compress_best;
+  double compress_median;
+  double decompress_best;
+  double decompress_median;
+  double compress_counters[COUNTERS];   /* per run, or -1 if not available */
+  double decompress_counters[COUNTERS]; /* per run, or -1 if not available */
+} result_t;
+
+/* one entry of the baseline for -c, i.e. a line of the JSON output */
+typedef struct {
+  char name[128];
+  int level;
+  long size;
+  long compressed_size;
+  double compress_best;
+  double decompress_best;
+} baseline_t;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#if defined(BENCHMARK_PERF_EVENTS)
+
+static int open_counter(uint32_t type, uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = (group == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/* returns 0 if even the cycle counter is not available (e.g. in a container) */
+static int open_counters(void) {
+  const uint64_t l1_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  int leader = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (leader < 0) return 0;
+  counter_fds[COUNTER_CYCLES] = leader;
+  counter_fds[COUNTER_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+  counter_fds[COUNTER_BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+  counter_fds[COUNTER_L1_MISSES] = open_counter(PERF_TYPE_HW_CACHE, l1_miss, leader);
+  counter_fds[COUNTER_LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, leader);
+  return 1;
+}
+
+static void start_counters(void) {
+  if (counter_fds[COUNTER_CYCLES] < 0) return;
+  ioctl(counter_fds[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(counter_fds[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/* adds the counted events to the totals */
+static void stop_counters(double* totals) {
+  int i;
+  if (counter_fds[COUNTER_CYCLES] < 0) return;
+  ioctl(counter_fds[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  for (i = 0; i < COUNTERS; ++i) {
+    uint64_t value;
+    if (counter_fds[i] >= 0 && read(counter_fds[i], &value, sizeof(value)) == sizeof(value)) totals[i] += value;
+  }
+}
+
+#else
+
+static int open_counters(void) { return 0; }
+static void start_counters(void) {}
+static void stop_counters(double* totals) { (void)totals; }
+
+#endif /* BENCHMARK_PERF_EVENTS */
+
+/* average per run, or -1 for the counters which are not available */
+static void average_counters(double* totals, int repeats) {
+  int i;
+  for (i = 0; i < COUNTERS; ++i) totals[i] = (counter_fds[i] >= 0) ? totals[i] / repeats : -1;
+}
+
+static int counters_enabled(void) { return counter_fds[COUNTER_CYCLES] >= 0; }
+
+/* derive the reported metrics, -1 for those which are not available */
+static void compute_metrics(const double* counters, long size, double* metrics) {
+  int i;
+  for (i = 0; i < COUNTERS; ++i) metrics[i] = -1;
+  if (counters[COUNTER_CYCLES] <= 0) return;
+  metrics[0] = counters[COUNTER_CYCLES] / size;
+  if (counters[COUNTER_INSTRUCTIONS] >= 0) metrics[1] = counters[COUNTER_INSTRUCTIONS] / counters[COUNTER_CYCLES];
+  for (i = COUNTER_BRANCH_MISSES; i < COUNTERS; ++i)
+    if (counters[i] >= 0) metrics[i] = counters[i] * 1024 / size;
+}
+
+static int compare_double(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/* throughput in MB/s, from the fastest and the median run */
+static void summarize(double* times, int repeats, long size, double* best, double* median) {
+  qsort(times, repeats, sizeof(double), compare_double);
+  *best = size / times[0] / 1e6;
+  if (repeats % 2)
+    *median = size / times[repeats / 2] / 1e6;
+  else
+    *median = 2 * size / (times[repeats / 2 - 1] + times[repeats / 2]) / 1e6;
+}
+
+static uint8_t* read_file(const char* file_name, long* size) {
+  FILE* f = fopen(file_name, "rb");
+  if (!f) return NULL;
+  fseek(f, 0L, SEEK_END);
+  *size = ftell(f);
+  rewind(f);
+  if (*size > MAX_FILE_SIZE) {
+    fclose(f);
+    return NULL;
+  }
+
+  uint8_t* buffer = malloc(*size);
+  long read = fread(buffer, 1, *size, f);
+  fclose(f);
+  if (read != *size) {
+    free(buffer);
+    return NULL;
+  }
+  return buffer;
+}
+
+static int bench(result_t* result, const uint8_t* data, int warmup, int repeats) {
+  long size = result->size;
+  uint8_t* compressed = malloc(1.05 * size + 66);
+  uint8_t* decompressed = malloc(size);
+  double times[MAX_REPEATS];
+  int compressed_size = 0;
+  int i;
+
+  memset(result->compress_counters, 0, sizeof(result->compress_counters));
+  memset(result->decompress_counters, 0, sizeof(result->decompress_counters));
+
+  for (i = 0; i < warmup + repeats; ++i) {
+    double start, elapsed;
+    if (i >= warmup) start_counters();
+    start = now();
+    compressed_size = fastlz_compress_level(result->level, data, size, compressed);
+    elapsed = now() - start;
+    if (i >= warmup) {
+      stop_counters(result->compress_counters);
+      times[i - warmup] = elapsed;
+    }
+  }
+  summarize(times, repeats, size, &result->compress_best, &result->compress_median);
+  average_counters(result->compress_counters, repeats);
+  result->compressed_size = compressed_size;
+
+  for (i = 0; i < warmup + repeats; ++i) {
+    double start, elapsed;
+    int decompressed_size;
+    if (i >= warmup) start_counters();
+    start = now();
+    decompressed_size = fastlz_decompress(compressed, compressed_size, decompressed, size);
+    elapsed = now() - start;
+    if (i >= warmup) {
+      stop_counters(result->decompress_counters);
+      times[i - warmup] = elapsed;
+    }
+    if (decompressed_size != size) {
+      free(compressed);
+      free(decompressed);
+      return 1;
+    }
+  }
+  summarize(times, repeats, size, &result->decompress_best, &result->decompress_median);
+  average_counters(result->decompress_counters, repeats);
+
+  i = memcmp(data, decompressed, size);
+  free(compressed);
+  free(decompressed);
+  return i != 0;
+}
+
+static void print_header(int format, int warmup, int repeats) {
+  int i;
+  if (format == FORMAT_TABLE) {
+    printf("FastLZ %s, %d warmup and %d measured runs, MB/s as fastest (median)\n\n", FASTLZ_VERSION_STRING, warmup,
+           repeats);
+    printf("%25s %5s %10s %10s %7s %19s %19s", "file", "level", "size", "compressed", "ratio", "compress",
+           "decompress");
+    if (counters_enabled()) printf(" %10s %10s", "c/B IPC", "c/B IPC");
+    printf("\n");
+  } else if (format == FORMAT_CSV) {
+    printf("file,level,size,compressed,ratio,compress_best,compress_median,decompress_best,decompress_median");
+    if (counters_enabled()) {
+      for (i = 0; i < COUNTERS; ++i) printf(",compress_%s", metric_names[i]);
+      for (i = 0; i < COUNTERS; ++i) printf(",decompress_%s", metric_names[i]);
+    }
+    printf("\n");
+  } else {
+    printf("{\"version\": \"%s\", \"warmup\": %d, \"repeats\": %d, \"results\": [\n", FASTLZ_VERSION_STRING, warmup,
+           repeats);
+  }
+}
+
+static void print_metric(int format, const char* prefix, int i, double value) {
+  if (format == FORMAT_TABLE) {
+    if (value >= 0)
+      printf(" %*.2f", i == 0 ? 5 : 4, value);
+    else
+      printf(" %*s", i == 0 ? 5 : 4, "-");
+  } else if (format == FORMAT_CSV) {
+    if (value >= 0)
+      printf(",%.3f", value);
+    else
+      printf(",");
+  } else {
+    printf(", \"%s_%s\": ", prefix, metric_names[i]);
+    if (value >= 0)
+      printf("%.3f", value);
+    else
+      printf("null");
+  }
+}
+
+static void print_result(int format, const result_t* r, int first) {
+  double ratio = (100.0 * r->compressed_size) / r->size;
+  double compress_metrics[COUNTERS], decompress_metrics[COUNTERS];
+  int i;
+
+  compute_metrics(r->compress_counters, r->size, compress_metrics);
+  compute_metrics(r->decompress_counters, r->size, decompress_metrics);
+
+  if (format == FORMAT_TABLE) {
+    printf("%25s %5d %10ld %10ld %6.2f%% %8.1f (%8.1f) %8.1f (%8.1f)", r->name, r->level, r->size,
+           r->compressed_size, ratio, r->compress_best, r->compress_median, r->decompress_best, r->decompress_median);
+    if (counters_enabled()) {
+      for (i = 0; i < 2; ++i) print_metric(format, "compress", i, compress_metrics[i]);
+      for (i = 0; i < 2; ++i) print_metric(format, "decompress", i, decompress_metrics[i]);
+    }
+    printf("\n");
+  } else if (format == FORMAT_CSV) {
+    printf("%s,%d,%ld,%ld,%.2f,%.1f,%.1f,%.1f,%.1f", r->name, r->level, r->size, r->compressed_size, ratio,
+           r->compress_best, r->compress_median, r->decompress_best, r->decompress_median);
+    if (counters_enabled()) {
+      for (i = 0; i < COUNTERS; ++i) print_metric(format, "compress", i, compress_metrics[i]);
+      for (i = 0; i < COUNTERS; ++i) print_metric(format, "decompress", i, decompress_metrics[i]);
+    }
+    printf("\n");
+  } else {
+    /* one result per line, to keep the output easy to diff */
+    printf("%s{\"file\": \"%s\", \"level\": %d, \"size\": %ld, \"compressed\": %ld, \"ratio\": %.2f, ", first ? "" : ",\n",
+           r->name, r->level, r->size, r->compressed_size, ratio);
+    printf("\"compress_best\": %.1f, \"compress_median\": %.1f, ", r->compress_best, r->compress_median);
+    printf("\"decompress_best\": %.1f, \"decompress_median\": %.1f", r->decompress_best, r->decompress_median);
+    if (counters_enabled()) {
+      for (i = 0; i < COUNTERS; ++i) print_metric(format, "compress", i, compress_metrics[i]);
+      for (i = 0; i < COUNTERS; ++i) print_metric(format, "decompress", i, decompress_metrics[i]);
+    }
+    printf("}");
+  }
+  fflush(stdout);
+}
+
+static void print_footer(int format) {
+  if (format == FORMAT_JSON) printf("\n]}\n");
+}
+
+static int load_baseline(const char* file_name, baseline_t* baseline) {
+  char line[1024];
+  int count = 0;
+  FILE* f = fopen(file_name, "r");
+  if (!f) return -1;
+  while (count < MAX_BASELINE && fgets(line, sizeof(line), f)) {
+    baseline_t* b = baseline + count;
+    double ratio, median;
+    if (sscanf(line,
+               "{\"file\": \"%127[^\"]\", \"level\": %d, \"size\": %ld, \"compressed\": %ld, \"ratio\": %lf, "
+               "\"compress_best\": %lf, \"compress_median\": %lf, \"decompress_best\": %lf",
+               b->name, &b->level, &b->size, &b->compressed_size, &ratio, &b->compress_best, &median,
+               &b->decompress_best) == 8)
+      ++count;
+  }
+  fclose(f);
+  return count;
+}
+
+static const baseline_t* find_baseline(const baseline_t* baseline, int count, const char* name, int level) {
+  int i;
+  for (i = 0; i < count; ++i)
+    if (baseline[i].level == level && strcmp(baseline[i].name, name) == 0) return baseline + i;
+  return NULL;
+}
+
+/*
+  Throughput is compared using the fastest run, since noise from other
+  processes on the machine can only make a run slower.
+*/
+static int is_slower(const baseline_t* b, const result_t* r, double tolerance) {
+  return r->compress_best < b->compress_best * (1 - tolerance / 100) ||
+         r->decompress_best < b->decompress_best * (1 - tolerance / 100);
+}
+
+/* the compressed size is deterministic, allow only a tiny increase */
+static int is_larger(const baseline_t* b, const result_t* r) {
+  return r->size != b->size || r->compressed_size > b->compressed_size + b->compressed_size / 200;
+}
+
+static void print_check(const baseline_t* b, const result_t* r, int slower, int larger) {
+  printf("%25s %5d %6.2f%% %6.2f%% %8.1f %8.1f %+6.1f%% %8.1f %8.1f %+6.1f%%  %s\n", r->name, r->level,
+         (100.0 * b->compressed_size) / b->size, (100.0 * r->compressed_size) / r->size, b->compress_best,
+         r->compress_best, 100 * (r->compress_best / b->compress_best - 1), b->decompress_best, r->decompress_best,
+         100 * (r->decompress_best / b->decompress_best - 1),
+         (slower && larger) ? "SLOWER, LARGER" : slower ? "SLOWER" : larger ? "LARGER" : "ok");
+  fflush(stdout);
+}
+
+static void usage(void) {
+  printf("Usage: benchmark [options] [corpus-prefix]\n\n");
+  printf("Options:\n");
+  printf("  -w N     warmup runs (default 1)\n");
+  printf("  -r N     measured runs (default 5, at most %d)\n", MAX_REPEATS / 4);
+  printf("  -l N     only compression level N (default all levels)\n");
+  printf("  -f FMT   output format: table, csv, json (default table)\n");
+  printf("  -p       read hardware performance counters (Linux only)\n");
+  printf("  -c FILE  check against a baseline (from -f json), fail on regression\n");
+  printf("  -t N     tolerance for -c, in percent of throughput (default 10)\n");
+}
+
+int main(int argc, char** argv) {
+  const char* prefix = "../compression-corpus/";
+  const char* names[] = {"canterbury/alice29.txt",
+                         "canterbury/asyoulik.txt",
+                         "canterbury/cp.html",
+                         "canterbury/fields.c",
+                         "canterbury/grammar.lsp",
+                         "canterbury/kennedy.xls",
+                         "canterbury/lcet10.txt",
+                         "canterbury/plrabn12.txt",
+                         "canterbury/ptt5",
+                         "canterbury/sum",
+                         "canterbury/xargs.1",
+                         "silesia/dickens",
+                         "silesia/mozilla",
+                         "silesia/mr",
+                         "silesia/nci",
+                         "silesia/ooffice",
+                         "silesia/osdb",
+                         "silesia/reymont",
+                         "silesia/samba",
+                         "silesia/sao",
+                         "silesia/webster",
+                         "silesia/x-ray",
+                         "silesia/xml",
+                         "enwik/enwik8.txt"};
+  const int levels[] = {1, 2, 3, 4, 5, 6};
+
+  const int count = sizeof(names) / sizeof(names[0]);
+  const int level_count = sizeof(levels) / sizeof(levels[0]);
+  int warmup = 1;
+  int repeats = 5;
+  int only_level = 0;
+  int format = FORMAT_TABLE;
+  int perf = 0;
+  const char* baseline_file = NULL;
+  baseline_t baseline[MAX_BASELINE];
+  int baseline_count = 0;
+  double tolerance = 10;
+  int regressions = 0;
+  int first = 1;
+  int i, j;
+
+  for (i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(arg, "-w") == 0 && i + 1 < argc) {
+      warmup = atoi(argv[++i]);
+    } else if (strcmp(arg, "-r") == 0 && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else if (strcmp(arg, "-l") == 0 && i + 1 < argc) {
+      only_level = atoi(argv[++i]);
+    } else if (strcmp(arg, "-p") == 0) {
+      perf = 1;
+    } else if (strcmp(arg, "-c") == 0 && i + 1 < argc) {
+      baseline_file = argv[++i];
+    } else if (strcmp(arg, "-t") == 0 && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (strcmp(arg, "-f") == 0 && i + 1 < argc) {
+      const char* name = argv[++i];
+      if (strcmp(name, "table") == 0)
+        format = FORMAT_TABLE;
+      else if (strcmp(name, "csv") == 0)
+        format = FORMAT_CSV;
+      else if (strcmp(name, "json") == 0)
+        format = FORMAT_JSON;
+      else {
+        printf("Error: unknown output format %s!\n", name);
+        return 1;
+      }
+    } else if (arg[0] == '-') {
+      usage();
+      return 1;
+    } else {
+      prefix = arg;
+    }
+  }
+
+  if (warmup < 0 || repeats < 1 || repeats > MAX_REPEATS / 4 || tolerance < 0 || tolerance >= 100) {
+    usage();
+    return 1;
+  }
+
+  if (baseline_file) {
+    baseline_count = load_baseline(baseline_file, baseline);
+    if (baseline_count <= 0) {
+      printf("Error: can not read the baseline from %s!\n", baseline_file);
+      return 1;
+    }
+  }
+
+  if (perf && !open_counters())
+    fprintf(stderr, "Warning: hardware performance counters are not available, continuing without them\n");
+
+  if (baseline_count > 0) {
+    printf("Checking against %s, %d warmup and %d measured runs, tolerance %.1f%%\n\n", baseline_file, warmup,
+           repeats, tolerance);
+    printf("%25s %5s %15s %24s %24s\n", "file", "level", "ratio", "compress MB/s", "decompress MB/s");
+  } else {
+    print_header(format, warmup, repeats);
+  }
+
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    long size;
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    uint8_t* data = read_file(filename, &size);
+    if (!data) {
+      fprintf(stderr, "Warning: skipping %s (can not read, or too big)\n", filename);
+      free(filename);
+      continue;
+    }
+
+    for (j = 0; j < level_count; ++j) {
+      const baseline_t* b = find_baseline(baseline, baseline_count, name, levels[j]);
+      result_t result;
+      if (only_level && levels[j] != only_level) continue;
+      if (baseline_count > 0 && !b) continue;
+      result.name = name;
+      result.level = levels[j];
+      result.size = size;
+      if (bench(&result, data, warmup, repeats)) {
+        printf("Error on %s: round trip failed for level %d!\n", filename, levels[j]);
+        return 1;
+      }
+
+      if (b) {
+        int retry, slower, larger;
+
+        /* measure again, longer, before calling it a regression */
+        for (retry = 1; retry <= CHECK_RETRIES && is_slower(b, &result, tolerance); ++retry) {
+          result_t again = result;
+          if (bench(&again, data, warmup, repeats * 2 * retry)) {
+            printf("Error on %s: round trip failed for level %d!\n", filename, levels[j]);
+            return 1;
+          }
+          if (again.compress_best > result.compress_best) result.compress_best = again.compress_best;
+          if (again.decompress_best > result.decompress_best) result.decompress_best = again.decompress_best;
+        }
+
+        slower = is_slower(b, &result, tolerance);
+        larger = is_larger(b, &result);
+        if (slower || larger) ++regressions;
+        print_check(b, &result, slower, larger);
+        continue;
+      }
+
+      print_result(format, &result, first);
+      first = 0;
+    }
+
+    free(data);
+    free(filename);
+  }
+
+  if (baseline_count > 0) {
+    if (regressions > 0) {
+      printf("\nFAILED: %d regression(s) beyond the tolerance of %.1f%%\n", regressions, tolerance);
+      return 1;
+    }
+    printf("\nOK: no regression beyond the tolerance of %.1f%%\n", tolerance);
+    return 0;
+  }
+
+  print_footer(format);
+
+  return 0;
+}
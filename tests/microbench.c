@@ -0,0 +1,300 @@
+/*
+  FastLZ - Byte-aligned LZ77 compression library
+  Copyright (C) 2005-2020 Ariya Hidayat <ariya.hidayat@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fastlz.h"
+
+/*
+  Latency of compressing and decompressing small messages, one call at a
+  time, for synthetic payloads resembling real traffic.
+*/
+
+#define POOL_SIZE (256 * 1024)
+#define MESSAGE_COUNT 64
+#define MAX_MESSAGE_SIZE 8192
+#define MAX_ITERATIONS 1000000
+
+enum { FORMAT_TABLE, FORMAT_CSV };
+
+static uint32_t seed = 2463534242UL;
+
+static uint32_t rnd(void) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+static void generate_text(uint8_t* pool) {
+  const char* words[] = {"the",   "of",     "and",  "to",      "in",     "is",    "that",   "for",
+                         "it",    "as",     "was",  "with",    "be",     "by",    "on",     "not",
+                         "he",    "this",   "are",  "or",      "his",    "from",  "at",     "which",
+                         "but",   "have",   "an",   "had",     "they",   "you",   "were",   "their",
+                         "one",   "all",    "we",   "can",     "her",    "has",   "there",  "been",
+                         "if",    "more",   "when", "will",    "would",  "who",   "so",     "no",
+                         "data",  "system", "time", "message", "server", "error", "client", "request",
+                         "block", "memory", "file", "process", "value",  "user",  "result", "network"};
+  const int count = sizeof(words) / sizeof(words[0]);
+  long pos = 0;
+  while (pos < POOL_SIZE) {
+    const char* word = words[rnd() % count];
+    long len = strlen(word);
+    if (pos + len + 2 > POOL_SIZE) break;
+    memcpy(pool + pos, word, len);
+    pos += len;
+    if (rnd() % 12 == 0) pool[pos++] = (rnd() % 3) ? ',' : '.';
+    pool[pos++] = ' ';
+  }
+  memset(pool + pos, ' ', POOL_SIZE - pos);
+}
+
+static void generate_json(uint8_t* pool) {
+  const char* names[] = {"alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi"};
+  const char* states[] = {"active", "idle", "suspended", "pending"};
+  char record[256];
+  long pos = 0;
+  uint32_t id = 100000;
+  while (pos < POOL_SIZE) {
+    int len;
+    id += 1 + rnd() % 7;
+    len = sprintf(record,
+                  "{\"id\":%lu,\"user\":\"%s_%lu\",\"state\":\"%s\",\"score\":%lu.%02lu,\"retries\":%lu,"
+                  "\"tags\":[\"%s\",\"%s\"]},",
+                  (unsigned long)id, names[rnd() % 8], (unsigned long)(rnd() % 1000), states[rnd() % 4],
+                  (unsigned long)(rnd() % 100), (unsigned long)(rnd() % 100), (unsigned long)(rnd() % 4),
+                  states[rnd() % 4], names[rnd() % 8]);
+    if (pos + len > POOL_SIZE) break;
+    memcpy(pool + pos, record, len);
+    pos += len;
+  }
+  memset(pool + pos, ' ', POOL_SIZE - pos);
+}
+
+/* fixed-size records: timestamp, sensor id, flags, reading */
+static void generate_binary(uint8_t* pool) {
+  uint32_t timestamp = 1600000000UL;
+  uint32_t reading = 50000;
+  long pos;
+  for (pos = 0; pos + 16 <= POOL_SIZE; pos += 16) {
+    uint32_t sensor = rnd() % 16;
+    timestamp += rnd() % 4;
+    reading += (rnd() % 64) - 32;
+    pool[pos + 0] = timestamp & 255;
+    pool[pos + 1] = (timestamp >> 8) & 255;
+    pool[pos + 2] = (timestamp >> 16) & 255;
+    pool[pos + 3] = timestamp >> 24;
+    pool[pos + 4] = sensor;
+    pool[pos + 5] = 0;
+    pool[pos + 6] = (sensor < 4) ? 1 : 0;
+    pool[pos + 7] = 0;
+    pool[pos + 8] = reading & 255;
+    pool[pos + 9] = (reading >> 8) & 255;
+    pool[pos + 10] = (reading >> 16) & 255;
+    pool[pos + 11] = reading >> 24;
+    memset(pool + pos + 12, 0, 4);
+  }
+}
+
+static void generate_random(uint8_t* pool) {
+  long pos;
+  for (pos = 0; pos < POOL_SIZE; ++pos) pool[pos] = rnd() >> 24;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+typedef struct {
+  double mean;
+  double p50;
+  double p99;
+} latency_t;
+
+static void summarize(double* times, int iterations, double total, latency_t* latency) {
+  qsort(times, iterations, sizeof(double), compare_double);
+  latency->mean = total / iterations * 1e9;
+  latency->p50 = times[iterations / 2] * 1e9;
+  latency->p99 = times[(int)(iterations * 0.99)] * 1e9;
+}
+
+/* median cost of timing an empty call, included in all results */
+static double timer_overhead(double* times, int iterations) {
+  latency_t overhead;
+  int i;
+  for (i = 0; i < iterations; ++i) {
+    double start = now();
+    times[i] = now() - start;
+  }
+  summarize(times, iterations, 0, &overhead);
+  return overhead.p50;
+}
+
+static int bench(int level, const uint8_t* pool, int size, int iterations, double* times, int* compressed_size,
+                 latency_t* compress, latency_t* decompress) {
+  static uint8_t compressed[MESSAGE_COUNT][MAX_MESSAGE_SIZE + MAX_MESSAGE_SIZE / 16 + 66];
+  static uint8_t decompressed[MAX_MESSAGE_SIZE];
+  const uint8_t* messages[MESSAGE_COUNT];
+  int lengths[MESSAGE_COUNT];
+  double total;
+  int i;
+
+  /* distinct messages, spread over the pool */
+  for (i = 0; i < MESSAGE_COUNT; ++i) messages[i] = pool + (long)i * (POOL_SIZE - size) / MESSAGE_COUNT;
+
+  *compressed_size = 0;
+  for (i = 0; i < MESSAGE_COUNT; ++i) {
+    lengths[i] = fastlz_compress_level(level, messages[i], size, compressed[i]);
+    *compressed_size += lengths[i];
+  }
+  *compressed_size /= MESSAGE_COUNT;
+
+  total = now();
+  for (i = 0; i < iterations; ++i) {
+    int m = i % MESSAGE_COUNT;
+    double start = now();
+    fastlz_compress_level(level, messages[m], size, compressed[m]);
+    times[i] = now() - start;
+  }
+  summarize(times, iterations, now() - total, compress);
+
+  total = now();
+  for (i = 0; i < iterations; ++i) {
+    int m = i % MESSAGE_COUNT;
+    double start = now();
+    int result = fastlz_decompress(compressed[m], lengths[m], decompressed, size);
+    times[i] = now() - start;
+    if (result != size) return 1;
+  }
+  summarize(times, iterations, now() - total, decompress);
+
+  return memcmp(decompressed, messages[(iterations - 1) % MESSAGE_COUNT], size) != 0;
+}
+
+static void usage(void) {
+  printf("Usage: microbench [options]\n\n");
+  printf("Options:\n");
+  printf("  -n N     calls per measurement (default 20000, at most %d)\n", MAX_ITERATIONS);
+  printf("  -l N     only compression level N (default all levels)\n");
+  printf("  -f FMT   output format: table, csv (default table)\n");
+}
+
+int main(int argc, char** argv) {
+  const char* types[] = {"text", "json", "binary", "random"};
+  void (*generators[])(uint8_t*) = {generate_text, generate_json, generate_binary, generate_random};
+  const int sizes[] = {64, 128, 256, 512, 1024, 2048, 4096, 8192};
+  const int levels[] = {1, 2, 3, 4, 5, 6};
+
+  const int type_count = sizeof(types) / sizeof(types[0]);
+  const int size_count = sizeof(sizes) / sizeof(sizes[0]);
+  const int level_count = sizeof(levels) / sizeof(levels[0]);
+  int iterations = 20000;
+  int only_level = 0;
+  int format = FORMAT_TABLE;
+  uint8_t* pool = malloc(POOL_SIZE);
+  double* times;
+  int i, j, k;
+
+  for (i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "-n") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(arg, "-l") == 0 && i + 1 < argc) {
+      only_level = atoi(argv[++i]);
+    } else if (strcmp(arg, "-f") == 0 && i + 1 < argc) {
+      const char* name = argv[++i];
+      if (strcmp(name, "table") == 0)
+        format = FORMAT_TABLE;
+      else if (strcmp(name, "csv") == 0)
+        format = FORMAT_CSV;
+      else {
+        printf("Error: unknown output format %s!\n", name);
+        return 1;
+      }
+    } else {
+      usage();
+      return (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) ? 0 : 1;
+    }
+  }
+
+  if (iterations < 100 || iterations > MAX_ITERATIONS) {
+    usage();
+    return 1;
+  }
+  times = malloc(iterations * sizeof(double));
+
+  if (format == FORMAT_TABLE) {
+    printf("FastLZ %s, %d calls per measurement, latency in ns\n", FASTLZ_VERSION_STRING, iterations);
+    printf("Timer overhead (included): %.0f ns\n", timer_overhead(times, iterations));
+  } else {
+    printf("level,type,size,compressed,compress_mean,compress_p50,compress_p99,");
+    printf("decompress_mean,decompress_p50,decompress_p99\n");
+  }
+
+  for (k = 0; k < level_count; ++k) {
+    int level = levels[k];
+    if (only_level && level != only_level) continue;
+    if (format == FORMAT_TABLE) {
+      printf("\nLevel %d\n\n", level);
+      printf("%6s %5s %10s %26s %26s\n", "type", "size", "compressed", "compress mean/p50/p99",
+             "decompress mean/p50/p99");
+    }
+
+    for (i = 0; i < type_count; ++i) {
+      generators[i](pool);
+      for (j = 0; j < size_count; ++j) {
+        latency_t compress, decompress;
+        int compressed_size;
+        if (bench(level, pool, sizes[j], iterations, times, &compressed_size, &compress, &decompress)) {
+          printf("Error: round trip failed for %s (%d bytes) at level %d!\n", types[i], sizes[j], level);
+          return 1;
+        }
+        if (format == FORMAT_TABLE)
+          printf("%6s %5d %10d %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f\n", types[i], sizes[j], compressed_size,
+                 compress.mean, compress.p50, compress.p99, decompress.mean, decompress.p50, decompress.p99);
+        else
+          printf("%d,%s,%d,%d,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n", level, types[i], sizes[j], compressed_size,
+                 compress.mean, compress.p50, compress.p99, decompress.mean, decompress.p50, decompress.p99);
+        fflush(stdout);
+      }
+    }
+  }
+
+  free(times);
+  free(pool);
+  return 0;
+}
@@ -101,3 +101,151 @@ void REF_Level2_decompress(const uint8_t* input, int length, uint8_t* output) {
     }
   }
 }
+
+void REF_Level3_decompress(const uint8_t* input, int length, uint8_t* output) {
+  int src = 0;
+  int dest = 0;
+  while (src < length) {
+    int type = input[src] >> 5;
+    if (type == 0) {
+      /* literal run */
+      int run = 1 + input[src];
+      src = src + 1;
+      while (run > 0) {
+        output[dest] = input[src];
+        src = src + 1;
+        dest = dest + 1;
+        run = run - 1;
+      }
+    } else {
+      int next = 2;
+      int len = 2 + type;
+      if (type == 7) {
+        /* long match */
+        next = next + 1;
+        len = len + input[src + 1];
+      }
+
+      int ofs = 256 * (input[src] & 15) + input[src + next - 1];
+      if (input[src] & 16) {
+        /* match from 16-bit distance */
+        ofs += 256 * input[src + next];
+        next = next + 1;
+      }
+      src = src + next;
+
+      int ref = dest - ofs - 1;
+      while (len > 0) {
+        output[dest] = output[ref];
+        ref = ref + 1;
+        dest = dest + 1;
+        len = len - 1;
+      }
+    }
+  }
+}
+
+void REF_Level4_decompress(const uint8_t* input, int length, uint8_t* output) {
+  int src = 0;
+  int dest = 0;
+  while (src < length) {
+    int type = input[src] >> 5;
+    if (type == 0) {
+      /* literal run */
+      int run = 1 + input[src];
+      src = src + 1;
+      while (run > 0) {
+        output[dest] = input[src];
+        src = src + 1;
+        dest = dest + 1;
+        run = run - 1;
+      }
+    } else {
+      int next = 1;
+      int len = 2 + type;
+      if (type == 7) {
+        /* long match, with gamma code for match length */
+        int nn = 255;
+        while (nn == 255) {
+          nn = input[src + next];
+          next = next + 1;
+          len += nn;
+        }
+      }
+
+      int ofs;
+      if (input[src] & 16) {
+        /* match from 16-bit or 24-bit distance */
+        ofs = input[src + next] + 256 * input[src + next + 1];
+        next = next + 2;
+        if (input[src] & 8) {
+          ofs += 65536 * input[src + next];
+          next = next + 1;
+        }
+      } else {
+        ofs = 256 * (input[src] & 15) + input[src + next];
+        next = next + 1;
+      }
+      src = src + next;
+
+      int ref = dest - ofs - 1;
+      while (len > 0) {
+        output[dest] = output[ref];
+        ref = ref + 1;
+        dest = dest + 1;
+        len = len - 1;
+      }
+    }
+  }
+}
+
+void REF_Level5_decompress(const uint8_t* input, int length, uint8_t* output) {
+  int src = 0;
+  int dest = 0;
+  while (src < length) {
+    int type = input[src] >> 5;
+    if (type == 0) {
+      /* literal run, with gamma code for long run */
+      int run = 1 + input[src];
+      src = src + 1;
+      if (run == 32) {
+        int nn = 255;
+        while (nn == 255) {
+          nn = input[src];
+          src = src + 1;
+          run += nn;
+        }
+      }
+      while (run > 0) {
+        output[dest] = input[src];
+        src = src + 1;
+        dest = dest + 1;
+        run = run - 1;
+      }
+    } else {
+      int next = 2;
+      int len = 2 + type;
+      if (type == 7) {
+        /* long match */
+        next = next + 1;
+        len = len + input[src + 1];
+      }
+
+      int ofs = 256 * (input[src] & 15) + input[src + next - 1];
+      if (input[src] & 16) {
+        /* match from 16-bit distance */
+        ofs += 256 * input[src + next];
+        next = next + 1;
+      }
+      src = src + next;
+
+      int ref = dest - ofs - 1;
+      while (len > 0) {
+        output[dest] = output[ref];
+        ref = ref + 1;
+        dest = dest + 1;
+        len = len - 1;
+      }
+    }
+  }
+}
@@ -61,6 +61,9 @@ int compare(const char* name, const uint8_t* a, const uint8_t* b, int size) {
 /* prototype, implemented in refimpl.c */
 void REF_Level1_decompress(const uint8_t* input, int length, uint8_t* output);
 void REF_Level2_decompress(const uint8_t* input, int length, uint8_t* output);
+void REF_Level3_decompress(const uint8_t* input, int length, uint8_t* output);
+void REF_Level4_decompress(const uint8_t* input, int length, uint8_t* output);
+void REF_Level5_decompress(const uint8_t* input, int length, uint8_t* output);
 
 /*
   Same as test_roundtrip_level1 EXCEPT that the decompression is carried out
@@ -216,6 +219,243 @@ void test_ref_decompressor_level2(const char* name, const char* file_name) {
 #endif
 }
 
+/*
+  Same as test_roundtrip_level3 EXCEPT that the decompression is carried out
+  using the highly-simplified, unoptimized vanilla reference decompressor.
+*/
+
+void test_ref_decompressor_level3(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(3, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress\n", name, file_size, compressed_size, ratio);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+
+  /* intentionally mask out the block tag */
+  compressed_buffer[0] = compressed_buffer[0] & 31;
+
+  REF_Level3_decompress(compressed_buffer, compressed_size, uncompressed_buffer);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Same as test_roundtrip_level4 EXCEPT that the decompression is carried out
+  using the highly-simplified, unoptimized vanilla reference decompressor.
+*/
+
+void test_ref_decompressor_level4(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(4, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress\n", name, file_size, compressed_size, ratio);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+
+  /* intentionally mask out the block tag */
+  compressed_buffer[0] = compressed_buffer[0] & 31;
+
+  REF_Level4_decompress(compressed_buffer, compressed_size, uncompressed_buffer);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Same as test_roundtrip_level5 EXCEPT that the decompression is carried out
+  using the highly-simplified, unoptimized vanilla reference decompressor.
+*/
+
+void test_ref_decompressor_level5(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(5, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress\n", name, file_size, compressed_size, ratio);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+
+  /* intentionally mask out the block tag */
+  compressed_buffer[0] = compressed_buffer[0] & 31;
+
+  REF_Level5_decompress(compressed_buffer, compressed_size, uncompressed_buffer);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
 /*
   Read the content of the file.
   Compress it first using the Level 1 compressor.
@@ -371,81 +611,1798 @@ void test_roundtrip_level2(const char* name, const char* file_name) {
 #endif
 }
 
-int main(int argc, char** argv) {
-  const char* default_prefix = "../compression-corpus/";
-  const char* names[] = {"canterbury/alice29.txt",
-                         "canterbury/asyoulik.txt",
-                         "canterbury/cp.html",
-                         "canterbury/fields.c",
-                         "canterbury/grammar.lsp",
-                         "canterbury/kennedy.xls",
-                         "canterbury/lcet10.txt",
-                         "canterbury/plrabn12.txt",
-                         "canterbury/ptt5",
-                         "canterbury/sum",
-                         "canterbury/xargs.1",
-                         "silesia/dickens",
-                         "silesia/mozilla",
-                         "silesia/mr",
-                         "silesia/nci",
-                         "silesia/ooffice",
-                         "silesia/osdb",
-                         "silesia/reymont",
-                         "silesia/samba",
-                         "silesia/sao",
-                         "silesia/webster",
-                         "silesia/x-ray",
-                         "silesia/xml",
-                         "enwik/enwik8.txt"};
-
-  const char* prefix = (argc == 2) ? argv[1] : default_prefix;
-
-  const int count = sizeof(names) / sizeof(names[0]);
-  int i;
+/*
+  Read the content of the file.
+  Compress it first using the Level 3 compressor.
+  Decompress the output with Level 3 decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_level3(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(3, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it first using the Level 4 compressor.
+  Decompress the output with Level 4 decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_level4(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(4, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it first using the Level 5 compressor.
+  Decompress the output with Level 5 decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_level5(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(5, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it first using the Level 6 compressor.
+  Decompress the output with Level 6 decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_level6(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(6, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it first using the specified compression level.
+  Decompress the output with the unchecked decompressor for trusted input.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_trusted(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(level, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  int decompressed_size = fastlz_decompress_trusted(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it first favoring the decompression speed, at the specified level.
+  Decompress the output with the regular decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_fastdecode(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_fastdecode(level, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  int decompressed_size = fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file and split it into short messages.
+  Compress all the messages in one batch using the specified level.
+  Decompress them, again in one batch.
+  Compare the result with the original file content.
+*/
+#define BATCH_MESSAGE_SIZE 1000
+#define BATCH_MESSAGE_SLOT (BATCH_MESSAGE_SIZE + 66)
+
+void test_roundtrip_batch(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+  int count = (file_size + BATCH_MESSAGE_SIZE - 1) / BATCH_MESSAGE_SIZE;
+  const void** inputs = malloc(count * sizeof(void*));
+  void** outputs = malloc(count * sizeof(void*));
+  int* lengths = malloc(count * sizeof(int));
+  int* compressed_lengths = malloc(count * sizeof(int));
+  int* decompressed_lengths = malloc(count * sizeof(int));
+  uint8_t* compressed_buffer = malloc((long)count * BATCH_MESSAGE_SLOT);
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    inputs[i] = file_buffer + (long)i * BATCH_MESSAGE_SIZE;
+    outputs[i] = compressed_buffer + (long)i * BATCH_MESSAGE_SLOT;
+    lengths[i] = (i < count - 1) ? BATCH_MESSAGE_SIZE : file_size - (long)i * BATCH_MESSAGE_SIZE;
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  fastlz_compress_batch(level, inputs, lengths, outputs, compressed_lengths, count);
+  long compressed_size = 0;
+  for (i = 0; i < count; ++i) compressed_size += compressed_lengths[i];
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  memset(uncompressed_buffer, '-', file_size);
+  for (i = 0; i < count; ++i) {
+    inputs[i] = compressed_buffer + (long)i * BATCH_MESSAGE_SLOT;
+    outputs[i] = uncompressed_buffer + (long)i * BATCH_MESSAGE_SIZE;
+  }
+  int decompressed = fastlz_decompress_batch(inputs, compressed_lengths, outputs, lengths, decompressed_lengths, count);
+  if (decompressed != count) {
+    printf("Error on %s!\n", file_name);
+    printf("Only %d out of %d messages were decompressed\n", decompressed, count);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(inputs);
+  free(outputs);
+  free(lengths);
+  free(compressed_lengths);
+  free(decompressed_lengths);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10ld  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file and split it into segments of various sizes.
+  Compress the segments, without concatenating them, using the specified level.
+  Decompress the output with the regular decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_iovec(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+  /* a mix of tiny, short, and long segments, including empty ones */
+  const int sizes[] = {200, 0, 1, 7, 4096, 13, 64, 1000, 3, 65536, 20, 512};
+  const int sizes_count = sizeof(sizes) / sizeof(sizes[0]);
+  struct fastlz_iovec* iov = malloc((file_size / 1000 + sizes_count) * sizeof(struct fastlz_iovec));
+  int iovcnt = 0;
+  long pos = 0;
+  while (pos < file_size) {
+    long size = sizes[iovcnt % sizes_count];
+    if (size > file_size - pos) size = file_size - pos;
+    iov[iovcnt].iov_base = file_buffer + pos;
+    iov[iovcnt].iov_len = size;
+    pos += size;
+    ++iovcnt;
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size + iovcnt);
+  int compressed_size = fastlz_compressv(level, iov, iovcnt, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  int decompressed_size = fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(iov);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it first using the specified compression level.
+  Decompress the output into a list of separately allocated 4 KB pages.
+  Compare the result with the original file content.
+*/
+#define PAGE_SIZE 4096
+
+void test_roundtrip_pages(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_level(level, file_buffer, file_size, compressed_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  int page_count = (file_size + PAGE_SIZE - 1) / PAGE_SIZE;
+  void** pages = malloc(page_count * sizeof(void*));
+  int i;
+  for (i = 0; i < page_count; ++i) {
+    pages[i] = malloc(PAGE_SIZE);
+    memset(pages[i], '-', PAGE_SIZE);
+  }
+  int decompressed_size = fastlz_decompress_pages(compressed_buffer, compressed_size, pages, PAGE_SIZE, page_count);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  for (i = 0; i < page_count; ++i) {
+    long size = (i < page_count - 1) ? PAGE_SIZE : file_size - (long)i * PAGE_SIZE;
+    int result = compare(file_name, file_buffer + (long)i * PAGE_SIZE, pages[i], size);
+    if (result == 1) exit(1);
+    free(pages[i]);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(pages);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file and split it into 4 KB pages (ignoring the
+  last partial page).
+  Compress every page with the page compressor.
+  Decompress it with the page decompressor.
+  Compare the result with the original page.
+*/
+void test_roundtrip_page(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+  uint8_t* compressed_buffer = malloc(FASTLZ_PAGE_BOUND);
+  uint8_t* uncompressed_buffer = malloc(FASTLZ_PAGE_SIZE);
+  long compressed_size = 0;
+  long filled = 0;
+  long pos;
+
+#ifdef LOG
+  printf("Compressing and decompressing. Please wait...\n");
+#endif
+  for (pos = 0; pos + FASTLZ_PAGE_SIZE <= file_size; pos += FASTLZ_PAGE_SIZE) {
+    int page_size = fastlz_compress_page(file_buffer + pos, compressed_buffer);
+    if (fastlz_page_filled(file_buffer + pos)) ++filled;
+    compressed_size += page_size;
+    memset(uncompressed_buffer, '-', FASTLZ_PAGE_SIZE);
+    int decompressed_size = fastlz_decompress_page(compressed_buffer, page_size, uncompressed_buffer);
+    if (decompressed_size != FASTLZ_PAGE_SIZE) {
+      printf("Error on %s!\n", file_name);
+      printf("Decompressed size mismatch at %ld: expecting %d, actual %d\n", pos, FASTLZ_PAGE_SIZE, decompressed_size);
+      exit(1);
+    }
+    int result = compare(file_name, file_buffer + pos, uncompressed_buffer, FASTLZ_PAGE_SIZE);
+    if (result == 1) exit(1);
+  }
+  double ratio = (pos > 0) ? (100.0 * compressed_size) / pos : 0;
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10ld  (%.2f%%)  %ld filled pages\n", name, pos, compressed_size, ratio, filled);
+#endif
+}
+
+#define ADAPTIVE_BLOCK_SIZE 4096
+
+void test_roundtrip_adaptive(const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+  uint8_t* compressed_buffer = malloc(1.05 * ADAPTIVE_BLOCK_SIZE);
+  uint8_t* uncompressed_buffer = malloc(ADAPTIVE_BLOCK_SIZE);
+  long compressed_size = 0;
+  long pos;
+
+#ifdef LOG
+  printf("Compressing and decompressing. Please wait...\n");
+#endif
+  for (pos = 0; pos < file_size; pos += ADAPTIVE_BLOCK_SIZE) {
+    int length = (file_size - pos < ADAPTIVE_BLOCK_SIZE) ? file_size - pos : ADAPTIVE_BLOCK_SIZE;
+    int block_size = fastlz_compress_adaptive(file_buffer + pos, length, compressed_buffer);
+    compressed_size += block_size;
+    memset(uncompressed_buffer, '-', ADAPTIVE_BLOCK_SIZE);
+    int decompressed_size = fastlz_decompress(compressed_buffer, block_size, uncompressed_buffer, length);
+    if (decompressed_size != length) {
+      printf("Error on %s!\n", file_name);
+      printf("Decompressed size mismatch at %ld: expecting %d, actual %d\n", pos, length, decompressed_size);
+      exit(1);
+    }
+    int result = compare(file_name, file_buffer + pos, uncompressed_buffer, length);
+    if (result == 1) exit(1);
+  }
+  double ratio = (100.0 * compressed_size) / file_size;
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10ld  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  A fake clock which ticks once every time it is read.
+*/
+static unsigned long ticking_clock(void* context) {
+  unsigned long* ticks = (unsigned long*)context;
+  return (*ticks)++;
+}
+
+/*
+  Read the content of the file.
+  Compress it within the specified budget (in clock ticks).
+  Decompress the output with the regular decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_budget(unsigned long budget, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  unsigned long ticks = 0;
+  uint8_t* compressed_buffer = malloc(1.05 * file_size + 5 * (file_size / 65536 + 1));
+  int compressed_size =
+      fastlz_compress_budget(file_buffer, file_size, compressed_buffer, budget, ticking_clock, &ticks);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  if (uncompressed_buffer == NULL) {
+    free(file_buffer);
+    free(compressed_buffer);
+    printf("%25s %10ld  -> %10d  (%.2f%%)  skipped, can't decompress OOM\n", name, file_size, compressed_size, ratio);
+    exit(1);
+    return;
+  }
+  memset(uncompressed_buffer, '-', file_size);
+  int decompressed_size = fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  An allocator which counts the live blocks and their total size.
+*/
+struct counting_pool {
+  long blocks;
+  size_t bytes;
+  long calls;
+};
+
+static void* counting_alloc(void* opaque, size_t size) {
+  struct counting_pool* pool = (struct counting_pool*)opaque;
+  pool->blocks++;
+  pool->bytes += size;
+  pool->calls++;
+  return malloc(size);
+}
+
+static void counting_free(void* opaque, void* ptr) {
+  struct counting_pool* pool = (struct counting_pool*)opaque;
+  pool->blocks--;
+  free(ptr);
+}
+
+/*
+  Read the content of the file.
+  Compress it with the working memory from a counting allocator.
+  Check that exactly the reported amount of memory was requested and
+  released, and that the output is identical to the stack-based compressor.
+  Decompress the output with the regular decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_alloc(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  struct counting_pool pool = {0, 0, 0};
+  struct fastlz_allocator allocator = {counting_alloc, counting_free, &pool};
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_alloc(level, file_buffer, file_size, compressed_buffer, &allocator);
+  double ratio = (100.0 * compressed_size) / file_size;
+  if (pool.calls != 1 || pool.blocks != 0 || pool.bytes != fastlz_compress_memory(level)) {
+    printf("Error on %s!\n", file_name);
+    printf("Allocation mismatch: %ld calls, %ld blocks left, %ld bytes (expecting %ld)\n", pool.calls, pool.blocks,
+           (long)pool.bytes, (long)fastlz_compress_memory(level));
+    exit(1);
+  }
+  uint8_t* reference_buffer = malloc(1.05 * file_size);
+  int reference_size = fastlz_compress_level(level, file_buffer, file_size, reference_buffer);
+  if (compressed_size != reference_size || memcmp(compressed_buffer, reference_buffer, compressed_size) != 0) {
+    printf("Error on %s!\n", file_name);
+    printf("Output differs from fastlz_compress_level: %d vs %d bytes\n", compressed_size, reference_size);
+    exit(1);
+  }
+  free(reference_buffer);
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  memset(uncompressed_buffer, '-', file_size);
+  int decompressed_size = fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+/*
+  Read the content of the file.
+  Compress it with the specified filter and level.
+  Decompress the output with the regular decompressor.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_filtered(int level, int filter, int elem_size, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  uint8_t* scratch_buffer = malloc(file_size);
+  uint8_t* compressed_buffer = malloc(1.05 * file_size + 2);
+  int compressed_size =
+      fastlz_compress_filtered(level, filter, elem_size, file_buffer, file_size, compressed_buffer, scratch_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Decompressing. Please wait...\n");
+#endif
+  uint8_t* uncompressed_buffer = malloc(file_size);
+  memset(uncompressed_buffer, '-', file_size);
+  int decompressed_size = fastlz_decompress(compressed_buffer, compressed_size, uncompressed_buffer, file_size);
+  if (decompressed_size != file_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Decompressed size mismatch: expecting %ld, actual %d\n", file_size, decompressed_size);
+    exit(1);
+  }
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  int result = compare(file_name, file_buffer, uncompressed_buffer, file_size);
+  if (result == 1) {
+    free(uncompressed_buffer);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(scratch_buffer);
+  free(compressed_buffer);
+  free(uncompressed_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)\n", name, file_size, compressed_size, ratio);
+#endif
+}
+
+#if defined(FASTLZ_STATS)
+void test_stats(int level, const char* name, const char* file_name) {
+#ifdef LOG
+  printf("Processing %s...\n", name);
+#endif
+  FILE* f = fopen(file_name, "rb");
+  if (!f) {
+    printf("Error: can not open %s!\n", file_name);
+    exit(1);
+  }
+  fseek(f, 0L, SEEK_END);
+  long file_size = ftell(f);
+  rewind(f);
+
+#ifdef LOG
+  printf("Size is %ld bytes.\n", file_size);
+#endif
+  if (file_size > MAX_FILE_SIZE) {
+    fclose(f);
+    printf("%25s %10ld [skipped, file too big]\n", name, file_size);
+    return;
+  }
+
+  uint8_t* file_buffer = malloc(file_size);
+  long read = fread(file_buffer, 1, file_size, f);
+  fclose(f);
+  if (read != file_size) {
+    free(file_buffer);
+    printf("Error: only read %ld bytes!\n", read);
+    exit(1);
+  }
+
+#ifdef LOG
+  printf("Compressing. Please wait...\n");
+#endif
+  struct fastlz_stats stats;
+  memset(&stats, 0, sizeof(stats));
+  uint8_t* compressed_buffer = malloc(1.05 * file_size);
+  uint8_t* expected_buffer = malloc(1.05 * file_size);
+  int compressed_size = fastlz_compress_ex(level, file_buffer, file_size, compressed_buffer, &stats);
+  int expected_size = fastlz_compress_level(level, file_buffer, file_size, expected_buffer);
+  double ratio = (100.0 * compressed_size) / file_size;
+#ifdef LOG
+  printf("Compressing was completed: %ld -> %ld (%.2f%%)\n", file_size, compressed_size, ratio);
+#endif
+
+#ifdef LOG
+  printf("Comparing. Please wait...\n");
+#endif
+  if (compressed_size != expected_size) {
+    printf("Error on %s!\n", file_name);
+    printf("Compressed size mismatch: expecting %d, actual %d\n", expected_size, compressed_size);
+    exit(1);
+  }
+  int result = compare(file_name, expected_buffer, compressed_buffer, compressed_size);
+  if (result == 1) exit(1);
+
+  unsigned long histogram = 0;
+  int i;
+  for (i = 0; i < FASTLZ_STATS_LENGTHS; ++i) histogram += stats.match_lengths[i];
+  if (stats.literal_bytes + stats.match_bytes != (unsigned long)file_size || histogram != stats.matches ||
+      stats.near_matches + stats.far_matches != stats.matches || (level == 1 && stats.far_matches > 0)) {
+    printf("Error on %s!\n", file_name);
+    printf("Inconsistent statistics: %lu literal bytes, %lu match bytes, %lu matches (%lu near, %lu far)\n",
+           stats.literal_bytes, stats.match_bytes, stats.matches, stats.near_matches, stats.far_matches);
+    exit(1);
+  }
+
+  free(file_buffer);
+  free(compressed_buffer);
+  free(expected_buffer);
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10d  (%.2f%%)  %lu matches, %lu literals\n", name, file_size, compressed_size, ratio,
+         stats.matches, stats.literal_bytes);
+#endif
+}
+#endif
+
+int main(int argc, char** argv) {
+  const char* default_prefix = "../compression-corpus/";
+  const char* names[] = {"canterbury/alice29.txt",
+                         "canterbury/asyoulik.txt",
+                         "canterbury/cp.html",
+                         "canterbury/fields.c",
+                         "canterbury/grammar.lsp",
+                         "canterbury/kennedy.xls",
+                         "canterbury/lcet10.txt",
+                         "canterbury/plrabn12.txt",
+                         "canterbury/ptt5",
+                         "canterbury/sum",
+                         "canterbury/xargs.1",
+                         "silesia/dickens",
+                         "silesia/mozilla",
+                         "silesia/mr",
+                         "silesia/nci",
+                         "silesia/ooffice",
+                         "silesia/osdb",
+                         "silesia/reymont",
+                         "silesia/samba",
+                         "silesia/sao",
+                         "silesia/webster",
+                         "silesia/x-ray",
+                         "silesia/xml",
+                         "enwik/enwik8.txt"};
+
+  const char* prefix = (argc == 2) ? argv[1] : default_prefix;
+
+  const int count = sizeof(names) / sizeof(names[0]);
+  int i;
+
+  printf("Test reference decompressor for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_ref_decompressor_level1(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test reference decompressor for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_ref_decompressor_level2(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test reference decompressor for Level 3\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_ref_decompressor_level3(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test reference decompressor for Level 4\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_ref_decompressor_level4(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test reference decompressor for Level 5\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_ref_decompressor_level5(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_level1(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_level2(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip for Level 3\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_level3(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip for Level 4\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_level4(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip for Level 5\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_level5(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip for Level 6\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_level6(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test trusted decompressor for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_trusted(1, name, filename);
+    free(filename);
+  }
+  printf("\n");
 
-  printf("Test reference decompressor for Level 1\n\n");
+  printf("Test trusted decompressor for Level 2\n\n");
   for (i = 0; i < count; ++i) {
     const char* name = names[i];
     char* filename = malloc(strlen(prefix) + strlen(name) + 1);
     strcpy(filename, prefix);
     strcat(filename, name);
-    test_ref_decompressor_level1(name, filename);
+    test_roundtrip_trusted(2, name, filename);
     free(filename);
   }
   printf("\n");
 
-  printf("Test reference decompressor for Level 2\n\n");
+  printf("Test trusted decompressor for Level 3\n\n");
   for (i = 0; i < count; ++i) {
     const char* name = names[i];
     char* filename = malloc(strlen(prefix) + strlen(name) + 1);
     strcpy(filename, prefix);
     strcat(filename, name);
-    test_ref_decompressor_level2(name, filename);
+    test_roundtrip_trusted(3, name, filename);
     free(filename);
   }
   printf("\n");
 
-  printf("Test round-trip for Level 1\n\n");
+  printf("Test trusted decompressor for Level 4\n\n");
   for (i = 0; i < count; ++i) {
     const char* name = names[i];
     char* filename = malloc(strlen(prefix) + strlen(name) + 1);
     strcpy(filename, prefix);
     strcat(filename, name);
-    test_roundtrip_level1(name, filename);
+    test_roundtrip_trusted(4, name, filename);
     free(filename);
   }
   printf("\n");
 
-  printf("Test round-trip for Level 2\n\n");
+  printf("Test trusted decompressor for Level 5\n\n");
   for (i = 0; i < count; ++i) {
     const char* name = names[i];
     char* filename = malloc(strlen(prefix) + strlen(name) + 1);
     strcpy(filename, prefix);
     strcat(filename, name);
-    test_roundtrip_level2(name, filename);
+    test_roundtrip_trusted(5, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test trusted decompressor for Level 6\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_trusted(6, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test batch round-trip for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_batch(1, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test batch round-trip for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_batch(2, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test batch round-trip for Level 3\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_batch(3, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test batch round-trip for Level 5\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_batch(5, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test scatter-gather round-trip for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_iovec(1, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test scatter-gather round-trip for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_iovec(2, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test paged decompressor for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_pages(1, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test paged decompressor for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_pages(2, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test paged decompressor for Level 3\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_pages(3, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test 4 KB page compression\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_page(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test adaptive compression\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_adaptive(name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test decompression-speed mode for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_fastdecode(1, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test decompression-speed mode for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_fastdecode(2, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression within a generous budget\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_budget(1000000, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression within an exhausted budget\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_budget(0, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression with a custom allocator for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_alloc(2, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression with a custom allocator for Level 4\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_alloc(4, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip with filter for Level 1 (shuffle, 4-byte elements)\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_filtered(1, FASTLZ_FILTER_SHUFFLE, 4, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test round-trip with filter for Level 2 (delta, 3-byte elements)\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_filtered(2, FASTLZ_FILTER_DELTA, 3, name, filename);
     free(filename);
   }
   printf("\n");
 
+  printf("Test round-trip with filter for Level 2 (shuffle and delta, 8-byte elements)\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_roundtrip_filtered(2, FASTLZ_FILTER_SHUFFLE | FASTLZ_FILTER_DELTA, 8, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+#if defined(FASTLZ_STATS)
+  printf("Test compression statistics for Level 1\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_stats(1, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression statistics for Level 2\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_stats(2, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression statistics for Level 3\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_stats(3, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression statistics for Level 4\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_stats(4, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression statistics for Level 5\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_stats(5, name, filename);
+    free(filename);
+  }
+  printf("\n");
+
+  printf("Test compression statistics for Level 6\n\n");
+  for (i = 0; i < count; ++i) {
+    const char* name = names[i];
+    char* filename = malloc(strlen(prefix) + strlen(name) + 1);
+    strcpy(filename, prefix);
+    strcat(filename, name);
+    test_stats(6, name, filename);
+    free(filename);
+  }
+  printf("\n");
+#endif
+
   return 0;
 }
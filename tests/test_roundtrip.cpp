@@ -0,0 +1,205 @@
+/*
+  FastLZ - Byte-aligned LZ77 compression library
+  Copyright (C) 2005-2020 Ariya Hidayat <ariya.hidayat@gmail.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "fastlz.hpp"
+
+#define LOG
+#undef LOG
+
+#define MAX_FILE_SIZE (32 * 1024 * 1024)
+
+static bool read_file(const std::string& file_name, std::string& content) {
+  std::ifstream f(file_name, std::ios::binary);
+  if (!f) return false;
+  content.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static void check(bool condition, const std::string& file_name, const char* message) {
+  if (!condition) {
+    printf("Error on %s!\n", file_name.c_str());
+    printf("%s\n", message);
+    exit(1);
+  }
+}
+
+/*
+  Compress the file content into an std::string and decompress it into an
+  std::vector of std::byte, both through the buffer-reusing overloads.
+  Compare the result with the original file content.
+*/
+void test_roundtrip_buffers(int level, const char* name, const std::string& file_name) {
+  std::string file_buffer;
+  if (!read_file(file_name, file_buffer)) {
+    printf("Error: can not open %s!\n", file_name.c_str());
+    exit(1);
+  }
+  if (file_buffer.size() > MAX_FILE_SIZE) {
+    printf("%25s %10ld [skipped, file too big]\n", name, (long)file_buffer.size());
+    return;
+  }
+
+  std::string compressed;
+  bool ok = fastlz::compress(file_buffer, compressed, level);
+  check(ok && (file_buffer.empty() || !compressed.empty()), file_name, "Compression failed");
+  double ratio = file_buffer.empty() ? 0 : (100.0 * compressed.size()) / file_buffer.size();
+
+  std::vector<std::byte> decompressed;
+  ok = fastlz::decompress(std::string_view(compressed), decompressed, file_buffer.size());
+  check(ok, file_name, "Decompression failed");
+  check(decompressed.size() == file_buffer.size(), file_name, "Decompressed size mismatch");
+  check(memcmp(decompressed.data(), file_buffer.data(), file_buffer.size()) == 0, file_name, "Content mismatch");
+
+  /* a smaller output limit must fail cleanly and leave the output empty */
+  if (!file_buffer.empty()) {
+    ok = fastlz::decompress(compressed, decompressed, file_buffer.size() - 1);
+    check(!ok && decompressed.empty(), file_name, "Decompression past maxout did not fail");
+  }
+
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10ld  (%.2f%%)\n", name, (long)file_buffer.size(), (long)compressed.size(), ratio);
+#endif
+}
+
+#if defined(FASTLZ_HPP_PMR)
+/*
+  A memory resource which counts the allocations passed to its upstream.
+*/
+class counting_resource : public std::pmr::memory_resource {
+ public:
+  long allocations = 0;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+/*
+  Compress every 64 KB block of the file with one pair of contexts whose
+  buffers come from a memory resource, then decompress and compare.
+  Only the first block may allocate, all the others reuse the buffers.
+*/
+void test_roundtrip_contexts(int level, const char* name, const std::string& file_name) {
+  const std::size_t block_size = 65536;
+  std::string file_buffer;
+  if (!read_file(file_name, file_buffer)) {
+    printf("Error: can not open %s!\n", file_name.c_str());
+    exit(1);
+  }
+  if (file_buffer.size() > MAX_FILE_SIZE) {
+    printf("%25s %10ld [skipped, file too big]\n", name, (long)file_buffer.size());
+    return;
+  }
+
+  counting_resource resource;
+  fastlz::pmr::compressor compressor(level, &resource);
+  fastlz::pmr::decompressor decompressor(&resource);
+  check(compressor.get_allocator().resource() == &resource, file_name, "Wrong memory resource");
+
+  std::string_view content(file_buffer);
+  long compressed_size = 0;
+  long first_allocations = -1;
+  for (std::size_t pos = 0; pos < content.size(); pos += block_size) {
+    std::string_view block = content.substr(pos, block_size);
+    fastlz::bytes compressed = compressor.compress(block);
+    check(!compressed.empty(), file_name, "Compression failed");
+    compressed_size += compressed.size();
+    fastlz::bytes decompressed = decompressor.decompress(compressed, block_size);
+    check(decompressed.view() == block, file_name, "Content mismatch");
+    if (first_allocations < 0) first_allocations = resource.allocations;
+  }
+  check(resource.allocations == first_allocations, file_name, "Contexts did not reuse their buffers");
+  double ratio = content.empty() ? 0 : (100.0 * compressed_size) / content.size();
+
+#ifdef LOG
+  printf("OK.\n");
+#else
+  printf("%25s %10ld  -> %10ld  (%.2f%%)\n", name, (long)content.size(), compressed_size, ratio);
+#endif
+}
+#endif
+
+int main(int argc, char** argv) {
+  const char* default_prefix = "../compression-corpus/";
+  const char* names[] = {"canterbury/alice29.txt",
+                         "canterbury/asyoulik.txt",
+                         "canterbury/cp.html",
+                         "canterbury/fields.c",
+                         "canterbury/grammar.lsp",
+                         "canterbury/kennedy.xls",
+                         "canterbury/lcet10.txt",
+                         "canterbury/plrabn12.txt",
+                         "canterbury/ptt5",
+                         "canterbury/sum",
+                         "canterbury/xargs.1",
+                         "silesia/dickens",
+                         "silesia/mozilla",
+                         "silesia/mr",
+                         "silesia/nci",
+                         "silesia/ooffice",
+                         "silesia/osdb",
+                         "silesia/reymont",
+                         "silesia/samba",
+                         "silesia/sao",
+                         "silesia/webster",
+                         "silesia/x-ray",
+                         "silesia/xml",
+                         "enwik/enwik8.txt"};
+
+  const char* prefix = (argc == 2) ? argv[1] : default_prefix;
+
+  const int count = sizeof(names) / sizeof(names[0]);
+  int level, i;
+
+  for (level = 1; level <= 6; ++level) {
+    printf("Test C++ wrapper with reused buffers for Level %d\n\n", level);
+    for (i = 0; i < count; ++i) test_roundtrip_buffers(level, names[i], std::string(prefix) + names[i]);
+    printf("\n");
+  }
+
+#if defined(FASTLZ_HPP_PMR)
+  for (level = 1; level <= 2; ++level) {
+    printf("Test C++ contexts with a memory resource for Level %d\n\n", level);
+    for (i = 0; i < count; ++i) test_roundtrip_contexts(level, names[i], std::string(prefix) + names[i]);
+    printf("\n");
+  }
+#endif
+
+  return 0;
+}